@@ -0,0 +1,81 @@
+#! /bin/sh
+# Benchmark GNU cflow on a synthetic project.
+# Copyright (C) 2017 Sergey Poznyakoff
+#
+# GNU cflow is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# GNU cflow is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: bench.sh [-o FILE] [GENCORPUS-OPTIONS]
+#
+# Generates a project using gencorpus with the given options, runs
+# cflow on it in each of the modes listed below and prints the
+# results as tab-separated lines, preceded by a header line.  With
+# -o, the results are appended to FILE as well.
+#
+# The programs to use are taken from the environment variables CFLOW,
+# GENCORPUS and BENCHRUN.
+
+: ${CFLOW:=cflow}
+: ${GENCORPUS:=gencorpus}
+: ${BENCHRUN:=benchrun}
+
+results=
+if [ "$1" = "-o" ]; then
+    results=$2
+    shift 2
+fi
+
+dir=${TMPDIR:-/tmp}/cflow-bench.$$
+trap 'rm -rf $dir' 0 1 2 13 15
+mkdir $dir || exit 1
+$GENCORPUS -C $dir "$@" || exit 1
+
+files=`ls $dir/*.c | wc -l`
+lines=`cat $dir/*.c | wc -l`
+functions=`grep -c '^[a-z_0-9]*(' $dir/*.c | awk -F: '{ n += $2 } END { print n }'`
+date=`date +%Y-%m-%dT%H:%M:%S`
+
+# Mode name and cflow options for each run.  The tree modes use
+# --brief, as a full tree of a large graph grows exponentially.
+modes="parse:--emit-facts
+closure:--depth=1
+tree:--brief
+reverse:--brief --reverse
+xref:--xref
+posix:--format=posix
+levels:--levels
+dominators:--dominators --brief
+reach:--reachable-from=main"
+
+header="date	mode	files	functions	lines	wall	user	sys	maxrss	lines_per_sec"
+echo "$header"
+if [ -n "$results" ] && [ ! -s "$results" ]; then
+    echo "$header" > $results
+fi
+
+echo "$modes" | while IFS=: read mode options
+do
+    res=`$BENCHRUN $CFLOW $options -o /dev/null $dir/*.c` ||
+        echo "$0: cflow failed in mode $mode" >&2
+    echo "$res" |
+    awk -v date=$date -v mode=$mode -v files=$files -v functions=$functions \
+        -v lines=$lines '
+{ printf("%s\t%s\t%d\t%d\t%d\t%s\t%s\t%s\t%s\t%.0f\n",
+         date, mode, files, functions, lines, $1, $2, $3, $4,
+         $1 > 0 ? lines / $1 : 0) }' |
+    if [ -n "$results" ]; then
+        tee -a $results
+    else
+        cat
+    fi
+done
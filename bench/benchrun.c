@@ -0,0 +1,92 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Run a command and report the resources it used.
+
+   usage: benchrun COMMAND [ARGS...]
+
+   The standard output of the command is discarded.  Once it
+   terminates, a single line is printed, containing tab-separated wall
+   clock time, user and system CPU times (in seconds) and the peak
+   resident set size (in kilobytes on most systems).  The exit code is
+   that of the command. */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static double
+tv_sec(struct timeval *tv)
+{
+     return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+int
+main(int argc, char **argv)
+{
+     struct timeval start, end;
+     struct rusage ru;
+     pid_t pid;
+     int status;
+
+     if (argc < 2) {
+	  fprintf(stderr, "usage: %s COMMAND [ARGS...]\n", argv[0]);
+	  return 2;
+     }
+
+     gettimeofday(&start, NULL);
+     pid = fork();
+     if (pid == -1) {
+	  fprintf(stderr, "%s: cannot fork: %s\n", argv[0], strerror(errno));
+	  return 2;
+     }
+     if (pid == 0) {
+	  int fd = open("/dev/null", O_WRONLY);
+	  if (fd != -1) {
+	       dup2(fd, 1);
+	       close(fd);
+	  }
+	  execvp(argv[1], argv + 1);
+	  fprintf(stderr, "%s: cannot run %s: %s\n", argv[0], argv[1],
+		  strerror(errno));
+	  _exit(127);
+     }
+     while (waitpid(pid, &status, 0) == -1)
+	  if (errno != EINTR) {
+	       fprintf(stderr, "%s: waitpid: %s\n", argv[0], strerror(errno));
+	       return 2;
+	  }
+     gettimeofday(&end, NULL);
+     getrusage(RUSAGE_CHILDREN, &ru);
+
+     printf("%.3f\t%.3f\t%.3f\t%ld\n",
+	    tv_sec(&end) - tv_sec(&start),
+	    tv_sec(&ru.ru_utime),
+	    tv_sec(&ru.ru_stime),
+	    (long) ru.ru_maxrss);
+     if (WIFEXITED(status))
+	  return WEXITSTATUS(status);
+     return 128 + WTERMSIG(status);
+}
@@ -0,0 +1,404 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Generate a synthetic C project for benchmarking cflow.
+
+   The project consists of the files fileN.c, N = 0, 1, ..., and the
+   header corpus.h declaring their global functions.  Functions are
+   numbered across all files.  Unless recursion is requested, each
+   function calls only functions with greater numbers, so that the
+   call graph is acyclic.  The output depends only on the options, so
+   that the same options always produce the same project. */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <math.h>
+
+static char *progname;
+
+static unsigned nfiles = 10;      /* Number of files */
+static unsigned nfuncs = 100;     /* Number of functions per file */
+static unsigned fanout = 4;       /* Mean number of calls per function */
+static int distribution = 'u';    /* Distribution of the number of calls:
+				     'u' - uniform, 'g' - geometric,
+				     'p' - power law */
+static unsigned recursion = 0;    /* Percentage of calls going backwards */
+static unsigned nesting = 3;      /* Maximum nesting of blocks */
+static int blockvars = 0;         /* Declare variables in nested blocks */
+static unsigned statics = 30;     /* Percentage of static functions */
+static unsigned ntypedefs = 5;    /* Number of typedefs per file */
+static unsigned ncomments = 0;    /* Comment lines before each function */
+static unsigned nstrings = 0;     /* String literal lines in each function */
+static unsigned long long seed = 1;
+static char *dir = ".";
+
+static char *is_static;           /* Whether each function is static */
+
+/* Deterministic pseudo-random numbers (xorshift64*) */
+static unsigned long long
+rnd()
+{
+     seed ^= seed >> 12;
+     seed ^= seed << 25;
+     seed ^= seed >> 27;
+     return (seed * 2685821657736338717ULL) >> 11;
+}
+
+/* Return a random number in [0, n) */
+static unsigned
+rnd_below(unsigned n)
+{
+     return n ? rnd() % n : 0;
+}
+
+/* Return a random number in [0, 1) */
+static double
+rnd_unit()
+{
+     return (rnd() >> 11) / 9007199254740992.0;
+}
+
+/* Return the number of calls to generate in a function */
+static unsigned
+ncalls()
+{
+     unsigned n;
+
+     switch (distribution) {
+     case 'g':
+	  for (n = 0; rnd_unit() < (double) fanout / (fanout + 1); n++)
+	       ;
+	  return n;
+     case 'p': {
+	  /* Pareto distribution with shape 2, truncated */
+	  double u = 1.0 - rnd_unit();
+	  double x = fanout / 2.0 / sqrt(u);
+	  return x > 100.0 * fanout ? 100 * fanout : (unsigned) x;
+     }
+     default:
+	  return rnd_below(2 * fanout + 1);
+     }
+}
+
+static void
+usage(FILE *fp)
+{
+     fprintf(fp, "usage: %s [OPTIONS]\n", progname);
+     fprintf(fp, "Generate a synthetic C project for benchmarking cflow.\n\n");
+     fprintf(fp, "  -C DIR     create files in DIR (default .)\n");
+     fprintf(fp, "  -f N       number of files (default %u)\n", nfiles);
+     fprintf(fp, "  -n N       number of functions per file (default %u)\n",
+	     nfuncs);
+     fprintf(fp, "  -c N       mean number of calls per function (default %u)\n",
+	     fanout);
+     fprintf(fp, "  -D DIST    distribution of the number of calls: uniform, geometric\n"
+		 "             or power (default uniform)\n");
+     fprintf(fp, "  -r PCT     percentage of calls creating recursion (default %u)\n",
+	     recursion);
+     fprintf(fp, "  -N N       maximum nesting of blocks around calls (default %u)\n",
+	     nesting);
+     fprintf(fp, "  -b         declare a static and an automatic variable in each block\n");
+     fprintf(fp, "  -s PCT     percentage of static functions (default %u)\n",
+	     statics);
+     fprintf(fp, "  -t N       number of typedefs per file (default %u)\n",
+	     ntypedefs);
+     fprintf(fp, "  -m N       number of comment lines before each function (default %u)\n",
+	     ncomments);
+     fprintf(fp, "  -l N       number of string literal lines in each function (default %u)\n",
+	     nstrings);
+     fprintf(fp, "  -S SEED    random seed (default %llu)\n", seed);
+     fprintf(fp, "  -h         print this help\n");
+}
+
+static unsigned
+number(char *arg)
+{
+     char *p;
+     unsigned long n;
+
+     errno = 0;
+     n = strtoul(arg, &p, 10);
+     if (errno || *p || n > 1000000000) {
+	  fprintf(stderr, "%s: invalid number: %s\n", progname, arg);
+	  exit(1);
+     }
+     return n;
+}
+
+static FILE *
+create(char *name)
+{
+     char *buf = malloc(strlen(dir) + strlen(name) + 2);
+     FILE *fp;
+
+     if (!buf) {
+	  fprintf(stderr, "%s: not enough memory\n", progname);
+	  exit(1);
+     }
+     sprintf(buf, "%s/%s", dir, name);
+     fp = fopen(buf, "w");
+     if (!fp) {
+	  fprintf(stderr, "%s: cannot create %s: %s\n", progname, buf,
+		  strerror(errno));
+	  exit(1);
+     }
+     free(buf);
+     return fp;
+}
+
+static void
+close_file(FILE *fp)
+{
+     if (ferror(fp) || fclose(fp)) {
+	  fprintf(stderr, "%s: write error\n", progname);
+	  exit(1);
+     }
+}
+
+/* Print the name of the function number N */
+static void
+print_name(FILE *fp, unsigned n)
+{
+     fprintf(fp, "f%u_%u", n / nfuncs, n % nfuncs);
+}
+
+/* Choose a function for the function number N in file FILE to call.
+   Return -1 if none. */
+static long
+callee(unsigned n, unsigned file)
+{
+     unsigned total = nfiles * nfuncs;
+     unsigned span = 2 * nfuncs;
+     unsigned m;
+
+     if (rnd_below(100) < recursion)
+	  /* Call backwards, possibly the function itself */
+	  m = n - rnd_below(n < span ? n + 1 : span);
+     else if (n + 1 < total)
+	  m = n + 1 + rnd_below(total - n - 1 < span ? total - n - 1 : span);
+     else
+	  return -1;
+     if (is_static[m] && m / nfuncs != file)
+	  return -1;
+     return m;
+}
+
+static void
+indent(FILE *fp, unsigned level)
+{
+     while (level--)
+	  fputs("    ", fp);
+}
+
+static void
+gen_function(FILE *fp, unsigned n, unsigned file)
+{
+     unsigned i, calls, t = rnd_below(ntypedefs + 1);
+
+     if (ncomments) {
+	  fprintf(fp, "/*\n");
+	  for (i = 0; i < ncomments; i++)
+	       fprintf(fp, " * Line %u of the description of the function"
+		       " number %u, which is /not/ code *** f(x).\n", i, n);
+	  fprintf(fp, " */\n");
+     }
+     fprintf(fp, "%sint\n", is_static[n] ? "static " : "");
+     print_name(fp, n);
+     /* Use typedefs in parameters of some static functions and in
+	local variables */
+     if (is_static[n] && t < ntypedefs)
+	  fprintf(fp, "(int a, t%u_%u *p)\n", file, t);
+     else
+	  fprintf(fp, "(int a, char *p)\n");
+     fprintf(fp, "{\n    int r = 0;\n");
+     if (t < ntypedefs)
+	  fprintf(fp, "    t%u_%u v;\n", file, t);
+     if (nstrings) {
+	  fprintf(fp, "    char *s =");
+	  for (i = 0; i < nstrings; i++)
+	       fprintf(fp, "\n        \"SELECT a%u, b FROM t%u"
+		       " WHERE c = \\\"%u\\\" /* f(x) */\\n\"", i, n, i);
+	  fprintf(fp, ";\n");
+     }
+     fprintf(fp, "\n");
+
+     calls = ncalls();
+     for (i = 0; i < calls; i++) {
+	  long m = callee(n, file);
+	  unsigned depth, j;
+
+	  if (m < 0)
+	       continue;
+	  depth = rnd_below(nesting + 1);
+	  for (j = 0; j < depth; j++) {
+	       indent(fp, j + 1);
+	       if (j % 2)
+		    fprintf(fp, "while (a-- > %u) {\n", j);
+	       else
+		    fprintf(fp, "if (a > %u) {\n", i + j);
+	       if (blockvars) {
+		    indent(fp, j + 2);
+		    fprintf(fp, "static int s%u;\n", j);
+		    indent(fp, j + 2);
+		    fprintf(fp, "int t%u = s%u++;\n", j, j);
+	       }
+	  }
+	  indent(fp, depth + 1);
+	  print_name(fp, m);
+	  fprintf(fp, "(a + %u, 0);\n", i);
+	  for (j = depth; j > 0; j--) {
+	       indent(fp, j);
+	       fprintf(fp, "}\n");
+	  }
+     }
+     fprintf(fp, "    return r;\n}\n\n");
+}
+
+int
+main(int argc, char **argv)
+{
+     int c;
+     unsigned file, i, total;
+     FILE *fp, *hdr;
+
+     progname = argv[0];
+     while ((c = getopt(argc, argv, "bC:c:D:f:hl:m:n:N:r:s:S:t:")) != EOF) {
+	  switch (c) {
+	  case 'b':
+	       blockvars = 1;
+	       break;
+	  case 'C':
+	       dir = optarg;
+	       break;
+	  case 'c':
+	       fanout = number(optarg);
+	       break;
+	  case 'D':
+	       if (strcmp(optarg, "uniform") == 0
+		   || strcmp(optarg, "geometric") == 0
+		   || strcmp(optarg, "power") == 0)
+		    distribution = optarg[0];
+	       else {
+		    fprintf(stderr, "%s: unknown distribution: %s\n",
+			    progname, optarg);
+		    return 1;
+	       }
+	       break;
+	  case 'f':
+	       nfiles = number(optarg);
+	       break;
+	  case 'h':
+	       usage(stdout);
+	       return 0;
+	  case 'l':
+	       nstrings = number(optarg);
+	       break;
+	  case 'm':
+	       ncomments = number(optarg);
+	       break;
+	  case 'n':
+	       nfuncs = number(optarg);
+	       break;
+	  case 'N':
+	       nesting = number(optarg);
+	       break;
+	  case 'r':
+	       recursion = number(optarg);
+	       break;
+	  case 's':
+	       statics = number(optarg);
+	       break;
+	  case 'S':
+	       seed = number(optarg);
+	       break;
+	  case 't':
+	       ntypedefs = number(optarg);
+	       break;
+	  default:
+	       usage(stderr);
+	       return 1;
+	  }
+     }
+     if (nfiles == 0 || nfuncs == 0) {
+	  fprintf(stderr, "%s: nothing to generate\n", progname);
+	  return 1;
+     }
+     if (seed == 0)
+	  seed = 1;
+
+     total = nfiles * nfuncs;
+     is_static = malloc(total);
+     if (!is_static) {
+	  fprintf(stderr, "%s: not enough memory\n", progname);
+	  return 1;
+     }
+     for (i = 0; i < total; i++)
+	  is_static[i] = rnd_below(100) < statics;
+
+     hdr = create("corpus.h");
+     fprintf(hdr, "/* Generated by gencorpus */\n");
+     for (i = 0; i < total; i++)
+	  if (!is_static[i]) {
+	       fprintf(hdr, "int ");
+	       print_name(hdr, i);
+	       fprintf(hdr, "(int a, char *p);\n");
+	  }
+     close_file(hdr);
+
+     for (file = 0; file < nfiles; file++) {
+	  char name[32];
+
+	  sprintf(name, "file%u.c", file);
+	  fp = create(name);
+	  fprintf(fp, "/* Generated by gencorpus */\n#include \"corpus.h\"\n\n");
+	  for (i = 0; i < ntypedefs; i++)
+	       fprintf(fp,
+		       "typedef struct s%u_%u { int a%u_%u; char *b%u_%u; } t%u_%u;\n",
+		       file, i, file, i, file, i, file, i);
+	  if (ntypedefs)
+	       fprintf(fp, "\n");
+	  /* Declare static functions first, as they may be called before
+	     their definitions */
+	  for (i = 0; i < nfuncs; i++) {
+	       unsigned n = file * nfuncs + i;
+	       if (is_static[n]) {
+		    fprintf(fp, "static int ");
+		    print_name(fp, n);
+		    fprintf(fp, "();\n");
+	       }
+	  }
+	  fprintf(fp, "\n");
+	  for (i = 0; i < nfuncs; i++)
+	       gen_function(fp, file * nfuncs + i, file);
+	  if (file == 0) {
+	       fprintf(fp, "int\nmain(int argc, char **argv)\n{\n");
+	       for (i = 0; i < nfuncs && i < 8; i++) {
+		    fprintf(fp, "    ");
+		    print_name(fp, i);
+		    fprintf(fp, "(argc, argv[0]);\n");
+	       }
+	       fprintf(fp, "    return 0;\n}\n");
+	  }
+	  close_file(fp);
+     }
+     return 0;
+}
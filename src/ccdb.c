@@ -0,0 +1,547 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Support for compilation databases (compile_commands.json).
+
+   Each entry of the database supplies the source file name, the
+   directory to run the compiler in and the compiler command line.
+   The preprocessor options are extracted from the latter and the
+   preprocessor is run for each file in its directory.  Up to max_jobs
+   preprocessors run simultaneously, their output is collected in
+   temporary files and fed to the parser in the order of entries in
+   the database.  The same machinery serves the lists of input files
+   (see ccdb_parallel). */
+
+#include <cflow.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <wordsplit.h>
+
+struct ccdb_entry {
+     char *directory;      /* Directory to run the preprocessor in */
+     char *file;           /* Source file name */
+     char *opts;           /* Preprocessor options */
+     pid_t pid;            /* PID of the preprocessor, or 0 */
+     FILE *fp;             /* Temporary file receiving its output */
+};
+
+static struct ccdb_entry *ccdb;
+static size_t ccdb_count;  /* Number of entries in ccdb */
+static size_t ccdb_max;    /* Number of allocated entries */
+static size_t ccdb_next;   /* Next entry to be parsed */
+static size_t ccdb_start;  /* Next entry to be preprocessed */
+static long ccdb_running;  /* Number of running preprocessors */
+
+static struct obstack ccdb_stk;
+static int ccdb_stk_init;
+
+static void
+stk_init()
+{
+     if (!ccdb_stk_init) {
+	  obstack_init(&ccdb_stk);
+	  ccdb_stk_init = 1;
+     }
+}
+
+
+/* Minimal JSON reader */
+
+struct json_input {
+     const char *name;     /* File name */
+     char *p;              /* Current position */
+     int line;             /* Current line */
+};
+
+static void
+json_error(struct json_input *in, const char *msg)
+{
+     error(EX_FATAL, 0, "%s:%d: %s", in->name, in->line, msg);
+}
+
+static int
+json_skip_ws(struct json_input *in)
+{
+     for (; *in->p && isspace(*in->p); in->p++)
+	  if (*in->p == '\n')
+	       in->line++;
+     return *in->p;
+}
+
+static void
+json_expect(struct json_input *in, int c)
+{
+     if (json_skip_ws(in) != c) {
+	  char buf[80];
+	  snprintf(buf, sizeof buf, _("expected `%c'"), c);
+	  json_error(in, buf);
+     }
+     in->p++;
+}
+
+/* Encode the code point C in UTF-8 and store it on the obstack */
+static void
+json_grow_utf8(unsigned c)
+{
+     if (c < 0x80)
+	  obstack_1grow(&ccdb_stk, c);
+     else if (c < 0x800) {
+	  obstack_1grow(&ccdb_stk, 0xc0 | (c >> 6));
+	  obstack_1grow(&ccdb_stk, 0x80 | (c & 0x3f));
+     } else {
+	  obstack_1grow(&ccdb_stk, 0xe0 | (c >> 12));
+	  obstack_1grow(&ccdb_stk, 0x80 | ((c >> 6) & 0x3f));
+	  obstack_1grow(&ccdb_stk, 0x80 | (c & 0x3f));
+     }
+}
+
+/* Read a JSON string.  Return a pointer to its value, allocated on
+   ccdb_stk. */
+static char *
+json_string(struct json_input *in)
+{
+     json_expect(in, '"');
+     while (*in->p != '"') {
+	  int c = *in->p++;
+
+	  switch (c) {
+	  case 0:
+	  case '\n':
+	       json_error(in, _("unterminated string"));
+	       break;
+	  case '\\':
+	       switch (c = *in->p++) {
+	       case 'b':
+		    c = '\b';
+		    break;
+	       case 'f':
+		    c = '\f';
+		    break;
+	       case 'n':
+		    c = '\n';
+		    break;
+	       case 'r':
+		    c = '\r';
+		    break;
+	       case 't':
+		    c = '\t';
+		    break;
+	       case 'u': {
+		    char xbuf[5];
+		    int i;
+
+		    /* This also stops at the end of the input */
+		    for (i = 0; i < 4; i++)
+			 if (!isxdigit(in->p[i]))
+			      json_error(in, _("invalid \\u escape"));
+		    memcpy(xbuf, in->p, 4);
+		    xbuf[4] = 0;
+		    c = strtoul(xbuf, NULL, 16);
+		    in->p += 4;
+		    json_grow_utf8(c);
+		    continue;
+	       }
+	       case '"':
+	       case '\\':
+	       case '/':
+		    break;
+	       default:
+		    json_error(in, _("invalid escape sequence"));
+	       }
+	  }
+	  obstack_1grow(&ccdb_stk, c);
+     }
+     in->p++;
+     obstack_1grow(&ccdb_stk, 0);
+     return obstack_finish(&ccdb_stk);
+}
+
+/* Skip a JSON value */
+static void
+json_skip_value(struct json_input *in)
+{
+     switch (json_skip_ws(in)) {
+     case '"':
+	  obstack_free(&ccdb_stk, json_string(in));
+	  break;
+     case '[':
+	  in->p++;
+	  if (json_skip_ws(in) == ']') {
+	       in->p++;
+	       break;
+	  }
+	  do
+	       json_skip_value(in);
+	  while (json_skip_ws(in) == ',' && in->p++);
+	  json_expect(in, ']');
+	  break;
+     case '{':
+	  in->p++;
+	  if (json_skip_ws(in) == '}') {
+	       in->p++;
+	       break;
+	  }
+	  do {
+	       obstack_free(&ccdb_stk, json_string(in));
+	       json_expect(in, ':');
+	       json_skip_value(in);
+	  } while (json_skip_ws(in) == ',' && in->p++);
+	  json_expect(in, '}');
+	  break;
+     default:
+	  if (!isalnum(*in->p) && *in->p != '-')
+	       json_error(in, _("unexpected character"));
+	  while (*in->p && (isalnum(*in->p) || strchr("+-.", *in->p)))
+	       in->p++;
+     }
+}
+
+
+/* Extraction of preprocessor options */
+
+/* Options that take an argument, either attached (as in -isystem/usr/x,
+   which CMake often generates) or in the next word */
+static char *arg_opts[] = {
+     "-D",
+     "-U",
+     "-I",
+     "-include",
+     "-imacros",
+     "-isystem",
+     "-iquote",
+     "-idirafter",
+     NULL
+};
+
+/* Options without arguments */
+static char *flag_opts[] = {
+     "-ansi",
+     "-nostdinc",
+     "-undef",
+     NULL
+};
+
+/* Look up ARG in the table TAB.  If PREFIX is set, ARG may have an
+   argument attached to the option.  Return the length of the option
+   found, or 0 if there is none. */
+static size_t
+find_opt(char **tab, const char *arg, int prefix)
+{
+     for (; *tab; tab++) {
+	  size_t len = strlen(*tab);
+	  if (strncmp(arg, *tab, len) == 0
+	      && (arg[len] == 0 || prefix))
+	       return len;
+     }
+     return 0;
+}
+
+/* Add the shell-quoted word ARG, preceded by a space, to the obstack */
+static void
+grow_quoted(const char *arg)
+{
+     obstack_1grow(&ccdb_stk, ' ');
+     if (*arg && arg[strspn(arg, "abcdefghijklmnopqrstuvwxyz"
+			    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+			    "0123456789_-+=./,:@%")] == 0)
+	  obstack_grow(&ccdb_stk, arg, strlen(arg));
+     else {
+	  obstack_1grow(&ccdb_stk, '\'');
+	  for (; *arg; arg++) {
+	       if (*arg == '\'')
+		    obstack_grow(&ccdb_stk, "'\\''", 4);
+	       else
+		    obstack_1grow(&ccdb_stk, *arg);
+	  }
+	  obstack_1grow(&ccdb_stk, '\'');
+     }
+}
+
+/* Select preprocessor options from the compiler command line ARGV
+   (ARGV[0] being the compiler name).  Return them as a string,
+   suitable for use in a shell command line. */
+static char *
+extract_pp_opts(int argc, char **argv)
+{
+     int i;
+     size_t len;
+
+     for (i = 1; i < argc; i++) {
+	  char *arg = argv[i];
+
+	  if ((len = find_opt(arg_opts, arg, 1)) != 0) {
+	       grow_quoted(arg);
+	       if (arg[len] == 0 && i + 1 < argc)
+		    grow_quoted(argv[++i]);
+	  } else if (find_opt(flag_opts, arg, 0)
+		     || strncmp(arg, "-std=", 5) == 0)
+	       grow_quoted(arg);
+     }
+     obstack_1grow(&ccdb_stk, 0);
+     return obstack_finish(&ccdb_stk);
+}
+
+static void
+ccdb_add(struct json_input *in, char *directory, char *file,
+	 char *command, int argc, char **argv)
+{
+     struct ccdb_entry *ent;
+     struct wordsplit ws;
+
+     if (!file)
+	  json_error(in, _("missing \"file\" in compilation database entry"));
+     if (ccdb_count == ccdb_max) {
+	  ccdb_max += 64;
+	  ccdb = xrealloc(ccdb, ccdb_max * sizeof(ccdb[0]));
+     }
+     ent = ccdb + ccdb_count++;
+     ent->directory = directory;
+     ent->file = file;
+     ent->pid = 0;
+     ent->fp = NULL;
+     if (command) {
+	  if (wordsplit(command, &ws, WRDSF_DEFFLAGS))
+	       error(EX_FATAL, 0, "%s:%d: %s",
+		     in->name, in->line, wordsplit_strerror(&ws));
+	  ent->opts = extract_pp_opts(ws.ws_wordc, ws.ws_wordv);
+	  wordsplit_free(&ws);
+     } else
+	  ent->opts = extract_pp_opts(argc, argv);
+}
+
+/* Read compilation database from file NAME */
+void
+ccdb_load(const char *name)
+{
+     struct json_input in;
+     struct stat st;
+     FILE *fp;
+     char *buf;
+     size_t size;
+
+     stk_init();
+
+     fp = fopen(name, "r");
+     if (!fp)
+	  error(EX_FATAL, errno, _("cannot open `%s'"), name);
+     if (fstat(fileno(fp), &st))
+	  error(EX_FATAL, errno, _("cannot stat `%s'"), name);
+     buf = xmalloc(st.st_size + 1);
+     size = fread(buf, 1, st.st_size, fp);
+     buf[size] = 0;
+     fclose(fp);
+
+     in.name = name;
+     in.p = buf;
+     in.line = 1;
+
+     json_expect(&in, '[');
+     if (json_skip_ws(&in) == ']')
+	  in.p++;
+     else do {
+	  char *directory = NULL, *file = NULL, *command = NULL;
+	  char **argv = NULL;
+	  int argc = 0, argmax = 0;
+
+	  json_expect(&in, '{');
+	  if (json_skip_ws(&in) != '}') do {
+	       char *key = json_string(&in);
+	       json_expect(&in, ':');
+	       if (strcmp(key, "directory") == 0)
+		    directory = json_string(&in);
+	       else if (strcmp(key, "file") == 0)
+		    file = json_string(&in);
+	       else if (strcmp(key, "command") == 0)
+		    command = json_string(&in);
+	       else if (strcmp(key, "arguments") == 0) {
+		    json_expect(&in, '[');
+		    if (json_skip_ws(&in) != ']') do {
+			 if (argc == argmax) {
+			      argmax += 16;
+			      argv = xrealloc(argv, argmax * sizeof(argv[0]));
+			 }
+			 argv[argc++] = json_string(&in);
+		    } while (json_skip_ws(&in) == ',' && in.p++);
+		    json_expect(&in, ']');
+	       } else
+		    json_skip_value(&in);
+	  } while (json_skip_ws(&in) == ',' && in.p++);
+	  json_expect(&in, '}');
+
+	  ccdb_add(&in, directory, file, command, argc, argv);
+	  free(argv);
+     } while (json_skip_ws(&in) == ',' && in.p++);
+     json_expect(&in, ']');
+     if (json_skip_ws(&in))
+	  json_error(&in, _("garbage after compilation database"));
+     free(buf);
+}
+
+
+/* Preprocessor jobs */
+
+static void
+job_start(struct ccdb_entry *ent)
+{
+     char *cmd, *name;
+
+     grow_quoted(ent->file);
+     obstack_1grow(&ccdb_stk, 0);
+     name = obstack_finish(&ccdb_stk);
+     /* Skip the leading space */
+     cmd = pp_command(ent->opts, name + 1);
+     obstack_free(&ccdb_stk, name);
+     if (debug)
+	  fprintf(stderr, _("Command line: %s\n"), cmd);
+
+     ent->fp = tmpfile();
+     if (!ent->fp)
+	  error(EX_FATAL, errno, _("cannot create temporary file"));
+     fcntl(fileno(ent->fp), F_SETFD, FD_CLOEXEC);
+
+     ent->pid = fork();
+     if (ent->pid == -1)
+	  error(EX_FATAL, errno, _("cannot fork"));
+     if (ent->pid == 0) {
+	  if (ent->directory && chdir(ent->directory)) {
+	       error(0, errno, _("cannot change to directory `%s'"),
+		     ent->directory);
+	       _exit(127);
+	  }
+	  dup2(fileno(ent->fp), 1);
+	  execl("/bin/sh", "sh", "-c", cmd, NULL);
+	  _exit(127);
+     }
+     free(cmd);
+     ccdb_running++;
+}
+
+/* Wait for the preprocessor of the entry ENT to terminate. Return 0 if
+   it succeeded. */
+static int
+job_wait(struct ccdb_entry *ent)
+{
+     int status;
+
+     while (waitpid(ent->pid, &status, 0) == -1)
+	  if (errno != EINTR)
+	       error(EX_FATAL, errno, _("waitpid failed"));
+     ent->pid = 0;
+     ccdb_running--;
+     if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+	  return 0;
+     if (WIFEXITED(status))
+	  error(0, 0, _("%s: preprocessor exited with status %d"),
+		ent->file, WEXITSTATUS(status));
+     else
+	  error(0, 0, _("%s: preprocessor terminated on signal %d"),
+		ent->file, WTERMSIG(status));
+     return 1;
+}
+
+/* Return the maximum number of preprocessors to run simultaneously */
+static long
+job_limit()
+{
+     long jobs = max_jobs;
+
+     if (jobs <= 0) {
+	  jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	  if (jobs <= 0)
+	       jobs = 1;
+     }
+     return jobs;
+}
+
+/* Prepare the next file from the compilation database for parsing.
+   Return 0 on success, 1 if the file cannot be parsed, and -1 if there
+   are no more files. */
+int
+ccdb_source()
+{
+     struct ccdb_entry *ent;
+     long jobs = job_limit();
+
+     if (ccdb_next == ccdb_count)
+	  return -1;
+     ent = ccdb + ccdb_next++;
+
+     /* Keep up to JOBS preprocessors running, including the one we are
+	going to wait for. */
+     while (ccdb_start < ccdb_count && ccdb_running < jobs)
+	  job_start(ccdb + ccdb_start++);
+
+     if (job_wait(ent)) {
+	  fclose(ent->fp);
+	  return 1;
+     }
+     rewind(ent->fp);
+     source_stream(ent->file, ent->fp);
+     ent->fp = NULL;
+     return 0;
+}
+
+/* Preprocess the files whose names are returned by successive calls to
+   NEXT(DATA), until it returns NULL, and parse them in that order.  Up
+   to max_jobs preprocessors run simultaneously; names are requested
+   only as there is room for a new job.  Return 0 if all files were
+   parsed. */
+int
+ccdb_parallel(char *(*next)(void *), void *data)
+{
+     long jobs = job_limit();
+     struct ccdb_entry *ring = xcalloc(jobs, sizeof(ring[0]));
+     long head = 0;   /* Index of the oldest job in ring */
+     long count = 0;  /* Number of jobs in ring */
+     int eof = 0;
+     int status = 0;
+
+     stk_init();
+     for (;;) {
+	  struct ccdb_entry *ent;
+
+	  while (!eof && count < jobs) {
+	       char *name = next(data);
+	       if (!name) {
+		    eof = 1;
+		    break;
+	       }
+	       ent = ring + (head + count) % jobs;
+	       ent->directory = NULL;
+	       ent->file = name;
+	       ent->opts = NULL;
+	       job_start(ent);
+	       count++;
+	  }
+	  if (count == 0)
+	       break;
+	  ent = ring + head;
+	  head = (head + 1) % jobs;
+	  count--;
+	  if (job_wait(ent)) {
+	       fclose(ent->fp);
+	       status = 1;
+	       continue;
+	  }
+	  rewind(ent->fp);
+	  source_stream(ent->file, ent->fp);
+	  parse_input();
+     }
+     free(ring);
+     return status;
+}
@@ -115,12 +115,16 @@ struct symbol {
      int token_type;               /* Type of the token */
      char *source;                 /* Source file */
      int def_line;                 /* Source line */
-     struct linked_list *ref_line; /* Referenced in */
+     int referenced;               /* Set to 1 if the symbol has been
+				      referenced */
+     struct linked_list *ref_line; /* Referenced in (for xref output only) */
      
      int level;                    /* Block nesting level (for local vars),
 				      Parameter nesting level (for params) */
      
      char *decl;                   /* Declaration */ 
+     struct saved_decl *saved_decl;/* Declaration tokens, if decl is not
+				      yet composed (see symbol_decl) */
      enum storage storage;         /* Storage type */
      
      int arity;                    /* Number of parameters or -1 for
@@ -128,14 +132,22 @@ struct symbol {
      
      int recursive;                /* Is the function recursive */
      size_t ord;                   /* ordinal number */
-     struct linked_list *caller;   /* List of callers */
+     struct linked_list *caller;   /* List of callers (built only for
+				      reverse trees) */
      struct linked_list *callee;   /* List of callees */
+     unsigned long edge_stamp;     /* Equal to the stamp of the current
+				      caller if the symbol is in its list
+				      of callees (see set_caller) */
 };
 
 /* Output flags */
 #define PRINT_XREF 0x01
 #define PRINT_TREE 0x02
 
+/* Compilation unit boundaries in the input (--split-units) */
+#define SPLIT_UNITS_PRAGMA  0x01 /* #pragma cflow unit */
+#define SPLIT_UNITS_MARKERS 0x02 /* Line markers of the primary files */
+
 #ifndef CFLOW_PREPROC
 # define CFLOW_PREPROC "/usr/bin/cpp"
 #endif
@@ -166,6 +178,31 @@ extern int max_depth;
 extern int emacs_option;
 extern int debug;
 extern int preprocess_option;
+extern int split_units_option;
+extern int max_jobs;
+extern char *cache_dir;
+extern size_t cache_max_size;
+extern int cache_stats_option;
+extern char *db_dir;
+extern int emit_facts_option;
+extern int merge_option;
+extern char *serve_socket;
+extern int watch_option;
+extern struct linked_list *output_symbols;
+extern struct linked_list *reachable_from;
+extern struct linked_list *reaches;
+extern struct linked_list *path_list;
+extern int all_paths_option;
+extern struct linked_list *avoid_list;
+extern struct linked_list *skim_list;
+extern struct linked_list *recurse_list;
+extern struct linked_list *match_list;
+extern struct linked_list *exclude_list;
+extern int cache_headers_option;
+extern int levels_option;
+extern int dominators_option;
+extern int stats_option;
+extern int stream_option;
 extern int omit_arguments_option;
 extern int omit_symbol_names_option;
 
@@ -185,7 +222,9 @@ Symbol *install(char*, int);
 Symbol *install_ident(char *name, enum storage storage);
 void ident_change_storage(Symbol *sp, enum storage storage);
 void delete_autos(int level);
+void block_symbol(Symbol *sp);
 void delete_statics(void);
+void clear_symbols(void);
 void delete_parms(int level);
 void move_parms(int level);
 size_t collect_symbols(Symbol ***, int (*sel)(), size_t rescnt);
@@ -203,18 +242,144 @@ size_t linked_list_size(struct linked_list *list);
 int data_in_list(void *data, struct linked_list *list);
 
 int get_token(void);
+int input_is_stream(const char *name);
 int source(char *name);
+void source_stream(char *name, FILE *fp);
+int next_unit(void);
 void init_lex(int debug_level);
 void set_preprocessor(const char *arg);
 void pp_option(const char *arg); 
+char *pp_command(const char *opts, const char *name);
+FILE *pp_open(const char *name);
+void pp_close(FILE *fp);
+
+void ccdb_load(const char *name);
+int ccdb_source(void);
+int ccdb_parallel(char *(*next)(void *), void *data);
+
+struct filelist;
+struct filelist *filelist_open(const char *name);
+struct filelist *filelist_fdopen(int fd, const char *name, pid_t pid);
+char *filelist_next(struct filelist *fl);
+int filelist_close(struct filelist *fl);
+struct filelist *walk_start(const char *dir);
+
+typedef unsigned long long cache_hash_t;
+#define CACHE_HASH_INIT 14695981039346656037ULL
+
+struct hash_table;
+
+cache_hash_t cache_hash_buf(cache_hash_t h, const void *buf, size_t size);
+int cache_hash_file(cache_hash_t h, const char *name, cache_hash_t *ph);
+cache_hash_t cache_hash_command(cache_hash_t h, const char *cmd);
+struct hash_table *cache_deps_create(void);
+void cache_deps_add(struct hash_table *tab, const char *name);
+int cache_deps_check(FILE *fp);
+int cache_deps_write(FILE *out, struct hash_table *tab);
+FILE *ppcache_open(const char *name);
+void ppcache_finish(void);
+
+/* Values of stats_option */
+#define STATS_TEXT 1
+#define STATS_JSON 2
+
+/* Processing phases, for --stats */
+enum stats_phase {
+     STATS_OPTIONS,     /* Reading rc files and parsing options */
+     STATS_PARSE,       /* Parsing */
+     STATS_PREPROC,     /* Waiting for the preprocessor (part of parsing) */
+     STATS_SCAN,        /* Lexical analysis (part of parsing) */
+     STATS_RECURSION,   /* Marking recursive calls */
+     STATS_COLLECT,     /* Collecting and sorting symbols */
+     STATS_OUTPUT,      /* Producing the output */
+     STATS_PHASE_COUNT
+};
+
+/* Operation counters, for --stats */
+enum stats_counter {
+     STATS_TOKENS,      /* Tokens returned by the scanner */
+     STATS_RESTORE,     /* Calls to restore() (parser backtracks) */
+     STATS_TOKINS,      /* Tokens inserted into the token stack */
+     STATS_TOKDEL,      /* Calls to tokdel() */
+     STATS_LOOKUP,      /* Symbol table lookups */
+     STATS_PROBE,       /* Symbol table entries compared */
+     STATS_INSTALL,     /* Symbols installed */
+     STATS_DELETE,      /* Symbols deleted */
+     STATS_EDGE,        /* Distinct caller -> callee edges */
+     STATS_REF,         /* References to symbols */
+     STATS_LINE,        /* Output lines */
+     STATS_CALLEE_CHECK,/* Callees examined to tell duplicate edges */
+     STATS_BLOCK_EXIT,  /* Calls to delete_autos() */
+     STATS_BLOCK_SCAN,  /* Symbols examined by delete_autos() */
+     STATS_HDR_HIT,     /* Header regions replayed (--cache-headers) */
+     STATS_HDR_MISS,    /* Header regions parsed and cached */
+     STATS_COUNTER_COUNT
+};
+
+extern unsigned long long stats_counter[];
+#define STATS_COUNT(c) (stats_counter[c]++)
+
+void stats_init(void);
+int stats_phase(int phase);
+void stats_report(void);
+size_t symbol_max_chain(void);
+
+/* Static probes (USDT) for tracing with perf, bpftrace or systemtap.
+   Unless enabled at configure time, they expand to nothing. */
+#ifdef ENABLE_PROBES
+# include <sys/sdt.h>
+# define PROBE(name) DTRACE_PROBE(cflow, name)
+# define PROBE1(name, a) DTRACE_PROBE1(cflow, name, a)
+# define PROBE2(name, a, b) DTRACE_PROBE2(cflow, name, a, b)
+#else
+# define PROBE(name)
+# define PROBE1(name, a)
+# define PROBE2(name, a, b)
+#endif
+
+extern FILE *fact_output;
+void fact(int code, const char *fmt, ...);
+#define FACT(args) do { if (fact_output) fact args; } while (0)
+void facts_begin(FILE *fp, char *name);
+void facts_end(void);
+int factdb_replay(char *name);
+void factdb_depend(const char *name);
+void factdb_record_begin(char *name);
+void factdb_track_begin(FILE *fp, char *name);
+void factdb_track_end(FILE *out);
+void factdb_record_end(char *name);
+void emit_facts_begin(char *name);
+void facts_begin_region(FILE *fp);
+int hdrcache_replay(char *name, cache_hash_t hash);
+void hdrcache_record_begin(char *name, cache_hash_t hash);
+void hdrcache_record_end(int store);
+void emit_facts_finish(void);
+int merge_facts(char *name);
 
 void init_parse(void);
 int yyparse(void);
+void build_caller_lists(void);
+char *replay_facts(char *text, char *name);
+char *symbol_decl(Symbol *sym);
+
+void serve(char *name);
+void watch_add(char *name);
+void watch(void);
+void parse_input(void);
+void serve_request(int argc, char **argv);
 
 void output(void);
+void output_unit(void);
+void output_close(void);
+void query_output(void);
+int query_requested(void);
+void output_stream(FILE *fp);
 void newline(void);
 void print_level(int lev, int last);
 int globals_only(void);
+int parse_options(int argc, char **argv, int *index);
+void init(void);
+extern struct linked_list *arglist;
 int include_symbol(Symbol *sym);
 int symbol_is_function(Symbol *sym);
 
@@ -244,6 +409,7 @@ int register_output(const char *name,
 		    void *handler_data);
 int select_output_driver (const char *name);
 void output_init(void);
+size_t dominator_tree(struct output_symbol **ret);
 
 int gnu_output_handler(cflow_output_command cmd,
 		       FILE *outfile, int line,
@@ -113,6 +113,8 @@ depmap_isset(cflow_depmap_t dmap, size_t row, size_t col)
 void
 depmap_tc(cflow_depmap_t dmap)
 {
+     PROBE1(closure__begin, dmap->nrows);
      transitive_closure(dmap->r, dmap->nrows);
+     PROBE1(closure__end, dmap->nrows);
 }
 
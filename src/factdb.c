@@ -0,0 +1,443 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Fact database (--db).
+
+   While a source file is parsed, the parser records each operation it
+   performs on the symbol table as a "fact": a line beginning with a
+   one-letter code, followed by its arguments.  The codes are:
+
+     F FILE                  current source file changes to FILE
+     U FILE                  current compilation unit name changes to FILE
+     N                       next compilation unit begins
+     d NAME STORAGE PARMCNT LINE LEVEL TOKENS
+                             symbol NAME is defined, TOKENS being
+                             its declaration (see fact_define)
+     a NAME LEVEL PARMLEVEL  automatic variable NAME is declared
+     t NAME LINE             NAME is defined as a type
+     c NAME LINE             function NAME is called
+     r NAME LINE             symbol NAME is referenced
+     b NAME                  body of the function NAME begins
+     e                       function body ends
+     m LEVEL                 parameters become automatic variables
+     p LEVEL                 parameters above LEVEL go out of scope
+     x LEVEL                 automatic variables of LEVEL go out of scope
+
+   Replaying these facts (see replay_facts in parser.c) brings the
+   symbol table to exactly the same state as parsing the file would.
+   Declarations are kept as tokens, so that the options that shape
+   their output (--omit-arguments, --omit-symbol-names) take effect
+   when the facts are replayed.
+
+   The facts recorded for each file are kept in the database directory,
+   along with the list of files they were obtained from (the source
+   itself and, if it was preprocessed, the headers it includes) and a
+   hash of the options that affect parsing.  On subsequent runs, the
+   file is not parsed if none of these has changed: its facts are
+   replayed instead. */
+
+#include <cflow.h>
+#include <parser.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <xgetcwd.h>
+#include <hash.h>
+
+#define DB_MAGIC "cflow-db 1\n"
+#define DB_SUFFIX ".db"
+
+FILE *fact_output;           /* Stream to record facts to */
+static char *fact_filename;  /* Last recorded source file name */
+static char *fact_canonical; /* Last recorded compilation unit name */
+static Hash_table *fact_deps;/* Files the recorded facts depend on */
+
+/* Record a fact with the given CODE.  Its arguments are formatted
+   according to FMT. */
+void
+fact(int code, const char *fmt, ...)
+{
+     va_list ap;
+
+     if (strcmp(filename, fact_filename)) {
+	  free(fact_filename);
+	  fact_filename = xstrdup(filename);
+	  fprintf(fact_output, "F %s\n", filename);
+     }
+     if (strcmp(canonical_filename, fact_canonical)) {
+	  free(fact_canonical);
+	  fact_canonical = xstrdup(canonical_filename);
+	  fprintf(fact_output, "U %s\n", canonical_filename);
+     }
+     fputc(code, fact_output);
+     if (*fmt) {
+	  fputc(' ', fact_output);
+	  va_start(ap, fmt);
+	  vfprintf(fact_output, fmt, ap);
+	  va_end(ap);
+     }
+     fputc('\n', fact_output);
+}
+
+/* Start recording facts for the source file NAME to the stream FP */
+void
+facts_begin(FILE *fp, char *name)
+{
+     fact_output = fp;
+     fact_filename = xstrdup(name);
+     fact_canonical = xstrdup(name);
+}
+
+/* Start recording facts for a part of the current compilation unit
+   to the stream FP (see hdrcache.c).  The unit name is not recorded. */
+void
+facts_begin_region(FILE *fp)
+{
+     facts_begin(fp, filename);
+     free(fact_canonical);
+     fact_canonical = xstrdup(canonical_filename);
+}
+
+/* Stop recording facts */
+void
+facts_end()
+{
+     fact_output = NULL;
+     free(fact_filename);
+     fact_filename = NULL;
+     free(fact_canonical);
+     fact_canonical = NULL;
+}
+
+
+static int
+is_token(Symbol *sym)
+{
+     return sym->type == SymToken;
+}
+
+/* Compute the hash of the options that affect the facts recorded for
+   the source file NAME. */
+static cache_hash_t
+option_hash(char *name)
+{
+     static int computed;
+     static cache_hash_t hash;
+     cache_hash_t h;
+
+     if (!computed) {
+	  int flags[6];
+	  struct linked_list_entry *p;
+	  Symbol **symbols;
+	  size_t i, num;
+	  cache_hash_t sum = 0;
+
+	  flags[0] = strict_ansi;
+	  flags[1] = use_indentation;
+	  flags[2] = omit_arguments_option;
+	  flags[3] = omit_symbol_names_option;
+	  flags[4] = split_units_option;
+	  flags[5] = preprocess_option;
+	  h = cache_hash_buf(CACHE_HASH_INIT, DB_MAGIC, sizeof DB_MAGIC);
+	  hash = cache_hash_buf(h, flags, sizeof flags);
+
+	  /* Skimmed headers (see --skim-headers) */
+	  for (p = linked_list_head(skim_list); p; p = p->next)
+	       hash = cache_hash_buf(hash, p->data, strlen(p->data) + 1);
+
+	  /* Keywords and types (see --symbol) */
+	  num = collect_symbols(&symbols, is_token, 0);
+	  for (i = 0; i < num; i++) {
+	       Symbol *sp = symbols[i];
+
+	       h = cache_hash_buf(CACHE_HASH_INIT, sp->name,
+				  strlen(sp->name) + 1);
+	       h = cache_hash_buf(h, &sp->token_type, sizeof sp->token_type);
+	       if (sp->flag == symbol_alias)
+		    h = cache_hash_buf(h, sp->alias->name,
+				       strlen(sp->alias->name));
+	       sum += h;
+	  }
+	  free(symbols);
+	  hash = cache_hash_buf(hash, &sum, sizeof sum);
+	  computed = 1;
+     }
+
+     h = hash;
+     if (preprocess_option) {
+	  char *cmd = pp_command(NULL, name);
+	  h = cache_hash_command(h, cmd);
+	  free(cmd);
+     }
+     return h;
+}
+
+/* Return the name of the database entry for the source file NAME */
+static char *
+db_entry_name(char *name)
+{
+     static int initialized;
+     char *cwd, *s;
+     cache_hash_t h;
+
+     if (!initialized) {
+	  if (mkdir(db_dir, 0777) && errno != EEXIST)
+	       error(EX_FATAL, errno, _("cannot create directory `%s'"),
+		     db_dir);
+	  initialized = 1;
+     }
+     cwd = xgetcwd();
+     if (!cwd)
+	  xalloc_die();
+     h = cache_hash_buf(CACHE_HASH_INIT, cwd, strlen(cwd) + 1);
+     h = cache_hash_buf(h, name, strlen(name));
+     free(cwd);
+     s = xmalloc(strlen(db_dir) + 1 + 16 + sizeof DB_SUFFIX);
+     sprintf(s, "%s/%016llx%s", db_dir, h, DB_SUFFIX);
+     return s;
+}
+
+/* If the database contains valid facts for the source file NAME, replay
+   them and return 0.  Otherwise, return -1. */
+int
+factdb_replay(char *name)
+{
+     char *entry = db_entry_name(name);
+     FILE *fp;
+     char buf[sizeof DB_MAGIC];
+     cache_hash_t key;
+     struct stat st;
+     long pos;
+     char *text, *p;
+     size_t size;
+
+     fp = fopen(entry, "r");
+     free(entry);
+     if (!fp)
+	  return -1;
+     if (!fgets(buf, sizeof buf, fp) || strcmp(buf, DB_MAGIC)
+	 || fscanf(fp, "%llx\n", &key) != 1
+	 || key != option_hash(name)
+	 || cache_deps_check(fp)
+	 || fstat(fileno(fp), &st)
+	 || (pos = ftell(fp)) == -1) {
+	  fclose(fp);
+	  return -1;
+     }
+
+     size = st.st_size - pos;
+     text = xmalloc(size + 1);
+     if (fread(text, 1, size, fp) != size) {
+	  free(text);
+	  fclose(fp);
+	  return -1;
+     }
+     text[size] = 0;
+     fclose(fp);
+
+     if (debug)
+	  fprintf(stderr, _("%s: using facts from the database\n"), name);
+     /* The symbol table will refer to TEXT and NAME, so they are never
+	freed. */
+     p = replay_facts(text, xstrdup(name));
+     if (!p || *p)
+	  error(EX_FATAL, 0, _("%s: malformed fact database entry"), name);
+     return 0;
+}
+
+/* Note that the facts being recorded depend on the file NAME, named
+   in a line marker.  This is called for each marker, since a header
+   can affect the facts without producing any, e.g. by defining
+   macros. */
+void
+factdb_depend(const char *name)
+{
+     if (fact_deps && *name != '<' && hash_lookup(fact_deps, name) == NULL
+	 && access(name, R_OK) == 0)
+	  cache_deps_add(fact_deps, name);
+}
+
+/* Start recording facts for the source file NAME to the stream FP,
+   along with the files they depend on */
+void
+factdb_track_begin(FILE *fp, char *name)
+{
+     fact_deps = cache_deps_create();
+     cache_deps_add(fact_deps, name);
+     facts_begin(fp, name);
+}
+
+static bool
+dep_name_write(void *data, void *proc_data)
+{
+     char *name = data;
+
+     if (!strchr(name, '\n'))
+	  fprintf(proc_data, "%s\n", name);
+     return true;
+}
+
+/* Stop recording facts started by factdb_track_begin and write the
+   names of the files they depend on to OUT, one per line */
+void
+factdb_track_end(FILE *out)
+{
+     facts_end();
+     hash_do_for_each(fact_deps, dep_name_write, out);
+     hash_free(fact_deps);
+     fact_deps = NULL;
+}
+
+/* Start recording facts for the source file NAME */
+void
+factdb_record_begin(char *name)
+{
+     FILE *fp = tmpfile();
+     if (!fp)
+	  error(EX_FATAL, errno, _("cannot create temporary file"));
+     factdb_track_begin(fp, name);
+}
+
+/* Finish recording facts for the source file NAME and store them in the
+   database */
+void
+factdb_record_end(char *name)
+{
+     FILE *fp = fact_output;
+     char *entry, *tmpname;
+     int fd;
+     FILE *out;
+     char buf[8192];
+     size_t n;
+     int rc;
+
+     facts_end();
+
+     entry = db_entry_name(name);
+     tmpname = xmalloc(strlen(entry) + 8);
+     strcpy(tmpname, entry);
+     strcat(tmpname, ".XXXXXX");
+     fd = mkstemp(tmpname);
+     if (fd == -1) {
+	  error(0, errno, _("cannot create database entry for `%s'"), name);
+	  rc = -1;
+     } else {
+	  out = fdopen(fd, "w");
+	  fputs(DB_MAGIC, out);
+	  fprintf(out, "%016llx\n", option_hash(name));
+	  rc = cache_deps_write(out, fact_deps);
+	  rewind(fp);
+	  while (rc == 0 && (n = fread(buf, 1, sizeof buf, fp)) > 0)
+	       fwrite(buf, 1, n, out);
+	  if (ferror(fp) || ferror(out))
+	       rc = -1;
+	  if (fclose(out))
+	       rc = -1;
+	  if (rc == 0 && rename(tmpname, entry))
+	       rc = -1;
+	  if (rc)
+	       unlink(tmpname);
+     }
+     free(tmpname);
+     free(entry);
+     fclose(fp);
+     hash_free(fact_deps);
+     fact_deps = NULL;
+}
+
+
+/* Fact files (--emit-facts and --merge).
+
+   A fact file begins with the line FACTS_MAGIC.  It is followed by
+   the facts of each source file, introduced by the line `S NAME',
+   NAME being the name of the source. */
+
+#define FACTS_MAGIC "cflow-facts 1\n"
+
+static FILE *emit_file;
+
+/* Start recording facts for the source file NAME to the output file */
+void
+emit_facts_begin(char *name)
+{
+     if (!emit_file) {
+	  if (strcmp(outname, "-") == 0)
+	       emit_file = stdout;
+	  else {
+	       emit_file = fopen(outname, "w");
+	       if (!emit_file)
+		    error(EX_FATAL, errno, _("cannot open file `%s'"),
+			  outname);
+	  }
+	  fputs(FACTS_MAGIC, emit_file);
+     }
+     if (strchr(name, '\n'))
+	  error(EX_FATAL, 0, _("%s: invalid file name"), name);
+     fprintf(emit_file, "S %s\n", name);
+     facts_begin(emit_file, name);
+}
+
+/* Finish writing the fact file */
+void
+emit_facts_finish()
+{
+     if (emit_file && (ferror(emit_file) || fclose(emit_file)))
+	  error(EX_FATAL, errno, _("error writing to `%s'"), outname);
+}
+
+/* Read the fact file NAME and replay the facts from it.  Return 0 on
+   success. */
+int
+merge_facts(char *name)
+{
+     FILE *fp;
+     struct stat st;
+     char *text, *p, *next;
+     size_t size;
+
+     fp = fopen(name, "r");
+     if (!fp) {
+	  error(0, errno, _("cannot open `%s'"), name);
+	  return 1;
+     }
+     if (fstat(fileno(fp), &st)) {
+	  error(0, errno, _("cannot stat `%s'"), name);
+	  fclose(fp);
+	  return 1;
+     }
+     text = xmalloc(st.st_size + 1);
+     size = fread(text, 1, st.st_size, fp);
+     text[size] = 0;
+     fclose(fp);
+
+     if (strncmp(text, FACTS_MAGIC, sizeof FACTS_MAGIC - 1)) {
+	  error(0, 0, _("%s: not a fact file"), name);
+	  free(text);
+	  return 1;
+     }
+     /* The symbol table will refer to TEXT, so it is never freed. */
+     for (p = text + sizeof FACTS_MAGIC - 1; *p; p = next) {
+	  char *source;
+
+	  if (strncmp(p, "S ", 2) || !(next = strchr(p, '\n')))
+	       error(EX_FATAL, 0, _("%s: malformed fact file"), name);
+	  *next++ = 0;
+	  source = p + 2;
+	  next = replay_facts(next, source);
+	  if (!next)
+	       error(EX_FATAL, 0, _("%s: malformed fact file"), name);
+     }
+     return 0;
+}
@@ -0,0 +1,132 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Lists of input files (@FILE and --files-from).
+
+   A list contains file names separated by newlines or NUL characters
+   (as printed by `find -print0'), so that both kinds of lists are
+   accepted without telling them apart.  Empty names are ignored.  The
+   names are read one at a time as they are needed, therefore a list
+   may be arbitrarily long and may be produced by a pipe while the
+   files already read from it are being parsed.  A list may also be
+   written by a child process (see walk.c). */
+
+#include <cflow.h>
+#include <sys/wait.h>
+
+struct filelist {
+     char *name;          /* Name of the list file */
+     FILE *fp;            /* Stream to read it from */
+     pid_t pid;           /* Process writing the list, or 0 */
+     struct obstack stk;  /* Storage for the current name */
+};
+
+static struct filelist *
+filelist_create(const char *name, FILE *fp, pid_t pid)
+{
+     struct filelist *fl = xmalloc(sizeof *fl);
+
+     fl->name = xstrdup(name);
+     fl->fp = fp;
+     fl->pid = pid;
+     obstack_init(&fl->stk);
+     return fl;
+}
+
+/* Open the list of input files NAME.  The name `-' stands for the
+   standard input.  Return NULL on error. */
+struct filelist *
+filelist_open(const char *name)
+{
+     FILE *fp;
+
+     if (strcmp(name, "-") == 0) {
+	  int fd = dup(0);
+	  fp = fd == -1 ? NULL : fdopen(fd, "r");
+	  if (!fp && fd != -1)
+	       close(fd);
+     } else
+	  fp = fopen(name, "r");
+     if (!fp) {
+	  error(0, errno, _("cannot open `%s'"), name);
+	  return NULL;
+     }
+     return filelist_create(name, fp, 0);
+}
+
+/* Open the list NAME, written to the file descriptor FD by the process
+   PID.  Return NULL on error. */
+struct filelist *
+filelist_fdopen(int fd, const char *name, pid_t pid)
+{
+     FILE *fp = fdopen(fd, "r");
+
+     if (!fp) {
+	  error(0, errno, _("cannot open `%s'"), name);
+	  close(fd);
+	  return NULL;
+     }
+     return filelist_create(name, fp, pid);
+}
+
+/* Return the next file name from the list FL, or NULL if there are no
+   more.  The returned string is allocated by xmalloc. */
+char *
+filelist_next(struct filelist *fl)
+{
+     int c;
+     size_t len;
+     char *p, *s;
+
+     do {
+	  while ((c = getc(fl->fp)) != EOF && c != '\n' && c != 0)
+	       obstack_1grow(&fl->stk, c);
+	  len = obstack_object_size(&fl->stk);
+     } while (len == 0 && c != EOF);
+     if (len == 0) {
+	  if (ferror(fl->fp))
+	       error(0, errno, _("error reading `%s'"), fl->name);
+	  return NULL;
+     }
+     obstack_1grow(&fl->stk, 0);
+     p = obstack_finish(&fl->stk);
+     s = xstrdup(p);
+     obstack_free(&fl->stk, p);
+     return s;
+}
+
+/* Close the list FL.  If it is written by a process, wait for it to
+   terminate.  Return 0 if the list was read without errors. */
+int
+filelist_close(struct filelist *fl)
+{
+     int rc = ferror(fl->fp) != 0;
+
+     fclose(fl->fp);
+     if (fl->pid) {
+	  int status;
+
+	  while (waitpid(fl->pid, &status, 0) == -1)
+	       if (errno != EINTR)
+		    error(EX_FATAL, errno, _("waitpid failed"));
+	  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	       rc = 1;
+     }
+     obstack_free(&fl->stk, NULL);
+     free(fl->name);
+     free(fl);
+     return rc;
+}
@@ -19,12 +19,14 @@
 void
 print_function_name(Symbol *sym, int has_subtree)
 {
+     char *decl = symbol_decl(sym);
+     
      fprintf(outfile, "%s", sym->name);
      if (sym->arity >= 0)
 	  fprintf(outfile, "()");
-     if (sym->decl)
+     if (decl)
 	  fprintf(outfile, " <%s at %s:%d>",
-		  sym->decl,
+		  decl,
 		  sym->source,
 		  sym->def_line);
      if (sym->active) {
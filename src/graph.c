@@ -0,0 +1,899 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Call graph queries.
+
+   The queries work on the graph of the functions selected for output
+   (see include_symbol), built from their callee lists.  Nodes of the
+   graph are numbered in the alphabetical order of their names.  Edges
+   are kept in compressed arrays: the callees of node I are
+   callee[callee_start[I]] through callee[callee_start[I+1]-1], in the
+   order of calls, and its callers are kept likewise in caller.
+   Functions listed in avoid_list are left out of the graph. */
+
+#include <cflow.h>
+
+struct graph {
+     size_t count;          /* Number of nodes */
+     Symbol **sym;          /* Node symbols */
+     size_t *callee_start;  /* Start of the callees of each node */
+     size_t *callee;        /* Callees */
+     size_t *caller_start;  /* Start of the callers of each node */
+     size_t *caller;        /* Callers */
+};
+
+static int
+is_avoided(Symbol *sym)
+{
+     struct linked_list_entry *p;
+
+     for (p = linked_list_head(avoid_list); p; p = p->next)
+	  if (strcmp(sym->name, (char*)p->data) == 0)
+	       return 1;
+     return 0;
+}
+
+static int
+is_node(Symbol *sym)
+{
+     return symbol_is_function(sym) && include_symbol(sym)
+	     && !is_avoided(sym);
+}
+
+static int
+compare_nodes(const void *ap, const void *bp)
+{
+     Symbol * const *a = ap;
+     Symbol * const *b = bp;
+     int rc = strcmp((*a)->name, (*b)->name);
+     if (rc)
+	  return rc;
+     if (!(*a)->source || !(*b)->source)
+	  return !!(*a)->source - !!(*b)->source;
+     rc = strcmp((*a)->source, (*b)->source);
+     if (rc)
+	  return rc;
+     return (*a)->def_line - (*b)->def_line;
+}
+
+/* Return the node number of SYM in G, or -1 if it is not a node */
+static ssize_t
+node_of(struct graph *g, Symbol *sym)
+{
+     if (sym->ord < g->count && g->sym[sym->ord] == sym)
+	  return sym->ord;
+     return -1;
+}
+
+static void
+graph_build(struct graph *g)
+{
+     Symbol **symbols;
+     size_t i, j, num, edges;
+     struct linked_list_entry *p;
+
+     /* collect_functions lists static functions twice, so drop the
+	duplicates */
+     num = collect_functions(&symbols);
+     for (i = j = 0; i < num; i++)
+	  if (is_node(symbols[i]))
+	       symbols[j++] = symbols[i];
+     qsort(symbols, j, sizeof(*symbols), compare_nodes);
+     num = j;
+     for (i = j = 0; i < num; i++)
+	  if (j == 0 || symbols[i] != symbols[j-1])
+	       symbols[j++] = symbols[i];
+     g->count = j;
+     g->sym = symbols;
+     for (i = 0; i < g->count; i++)
+	  g->sym[i]->ord = i;
+
+     g->callee_start = xcalloc(g->count + 1, sizeof(g->callee_start[0]));
+     g->caller_start = xcalloc(g->count + 1, sizeof(g->caller_start[0]));
+     edges = 0;
+     for (i = 0; i < g->count; i++) {
+	  g->callee_start[i] = edges;
+	  for (p = linked_list_head(g->sym[i]->callee); p; p = p->next) {
+	       ssize_t n = node_of(g, p->data);
+	       if (n >= 0) {
+		    edges++;
+		    g->caller_start[n]++;
+	       }
+	  }
+     }
+     g->callee_start[g->count] = edges;
+
+     g->callee = xcalloc(edges + 1, sizeof(g->callee[0]));
+     g->caller = xcalloc(edges + 1, sizeof(g->caller[0]));
+     for (i = 0, edges = 0; i < g->count; i++) {
+	  for (p = linked_list_head(g->sym[i]->callee); p; p = p->next) {
+	       ssize_t n = node_of(g, p->data);
+	       if (n >= 0)
+		    g->callee[edges++] = n;
+	  }
+     }
+     /* Turn the caller counts into end positions, then fill the caller
+	lists backwards, so that each one is ordered by caller */
+     for (i = 1; i <= g->count; i++)
+	  g->caller_start[i] += g->caller_start[i-1];
+     for (i = g->count; i-- > 0; ) {
+	  for (j = g->callee_start[i]; j < g->callee_start[i+1]; j++)
+	       g->caller[--g->caller_start[g->callee[j]]] = i;
+     }
+}
+
+static void
+graph_free(struct graph *g)
+{
+     free(g->sym);
+     free(g->callee_start);
+     free(g->callee);
+     free(g->caller_start);
+     free(g->caller);
+}
+
+
+/* Reachability queries (--reachable-from, --reaches).
+
+   Up to SEED_BATCH seeds are traversed at once by a breadth-first
+   search propagating sets of seeds, one bit per seed, along the edges.
+   A node enters the frontier at the distance where some seeds reach it
+   for the first time, so that each batch costs O(V+E) operations on
+   words for every distinct distance at which the node is reached. */
+
+typedef unsigned long long seed_set;
+#define SEED_BATCH 64
+
+struct reach_entry {
+     size_t node;           /* Node reached */
+     int dist;              /* Its distance from the seed */
+};
+
+struct reach_result {
+     struct reach_entry *ent;
+     size_t count;
+     size_t max;
+};
+
+static int
+compare_reach(const void *ap, const void *bp)
+{
+     const struct reach_entry *a = ap;
+     const struct reach_entry *b = bp;
+     return a->node < b->node ? -1 : a->node > b->node;
+}
+
+/* Traverse G from the N seeds named in NAMES, along the callee edges,
+   or along the caller ones if REVERSE is set, and print the nodes
+   reached from each seed with their distances. */
+static void
+reach_batch(struct graph *g, int reverse, char **names, size_t n)
+{
+     size_t *start = reverse ? g->caller_start : g->callee_start;
+     size_t *adj = reverse ? g->caller : g->callee;
+     seed_set *visited, *frontier, *next;
+     size_t *cur, *nxt, ncur, nnxt;
+     struct reach_result *res;
+     size_t i, j, k;
+     int dist;
+
+     visited = xcalloc(g->count, sizeof(visited[0]));
+     frontier = xcalloc(g->count, sizeof(frontier[0]));
+     next = xcalloc(g->count, sizeof(next[0]));
+     cur = xcalloc(g->count, sizeof(cur[0]));
+     nxt = xcalloc(g->count, sizeof(nxt[0]));
+     res = xcalloc(n, sizeof(res[0]));
+
+     ncur = 0;
+     for (i = 0; i < n; i++) {
+	  int found = 0;
+	  for (j = 0; j < g->count; j++) {
+	       if (strcmp(g->sym[j]->name, names[i]) == 0) {
+		    if (!frontier[j])
+			 cur[ncur++] = j;
+		    frontier[j] |= (seed_set)1 << i;
+		    visited[j] |= (seed_set)1 << i;
+		    found = 1;
+	       }
+	  }
+	  if (!found)
+	       error(0, 0, _("%s: no such function"), names[i]);
+     }
+
+     for (dist = 1; ncur && (!max_depth || dist < max_depth); dist++) {
+	  nnxt = 0;
+	  for (i = 0; i < ncur; i++) {
+	       size_t v = cur[i];
+	       seed_set bits = frontier[v];
+
+	       frontier[v] = 0;
+	       for (j = start[v]; j < start[v+1]; j++) {
+		    size_t w = adj[j];
+		    if (!next[w])
+			 nxt[nnxt++] = w;
+		    next[w] |= bits;
+	       }
+	  }
+
+	  ncur = 0;
+	  for (i = 0; i < nnxt; i++) {
+	       size_t w = nxt[i];
+	       seed_set bits = next[w] & ~visited[w];
+
+	       next[w] = 0;
+	       if (!bits)
+		    continue;
+	       visited[w] |= bits;
+	       frontier[w] = bits;
+	       cur[ncur++] = w;
+	       for (k = 0; bits; k++, bits >>= 1) {
+		    struct reach_result *r;
+
+		    if (!(bits & 1))
+			 continue;
+		    r = &res[k];
+		    if (r->count == r->max)
+			 r->ent = x2nrealloc(r->ent, &r->max, sizeof(r->ent[0]));
+		    r->ent[r->count].node = w;
+		    r->ent[r->count].dist = dist;
+		    r->count++;
+	       }
+	  }
+     }
+
+     for (i = 0; i < n; i++) {
+	  struct reach_result *r = &res[i];
+
+	  qsort(r->ent, r->count, sizeof(r->ent[0]), compare_reach);
+	  fprintf(outfile, "%s:\n", names[i]);
+	  STATS_COUNT(STATS_LINE);
+	  for (j = 0; j < r->count; j++) {
+	       fprintf(outfile, "    %s %d\n",
+		       g->sym[r->ent[j].node]->name, r->ent[j].dist);
+	       STATS_COUNT(STATS_LINE);
+	  }
+	  free(r->ent);
+     }
+
+     free(res);
+     free(nxt);
+     free(cur);
+     free(next);
+     free(frontier);
+     free(visited);
+}
+
+static void
+reach_list(struct graph *g, int reverse, struct linked_list *list)
+{
+     struct linked_list_entry *p;
+     char *names[SEED_BATCH];
+     size_t n = 0;
+
+     for (p = linked_list_head(list); p; p = p->next) {
+	  names[n++] = p->data;
+	  if (n == SEED_BATCH) {
+	       reach_batch(g, reverse, names, n);
+	       n = 0;
+	  }
+     }
+     if (n)
+	  reach_batch(g, reverse, names, n);
+}
+
+
+/* Shortest call paths (--path).
+
+   The search proceeds from both ends at once: forward from the start
+   function along the callee edges and backward from the target along
+   the caller ones, advancing each time the smaller frontier by one
+   level.  Once the two searches meet, the nodes lying on shortest
+   paths are marked with their positions on the path, and the paths are
+   enumerated in the order of calls. */
+
+struct path_search {
+     struct graph *g;
+     int *dist_f;           /* Distance from the start, or -1 */
+     int *dist_b;           /* Distance to the target, or -1 */
+     int *pos;              /* Position on a shortest path, or -1 */
+     size_t *path;          /* Path being built */
+     int len;               /* Length of the shortest paths */
+     int count;             /* Number of paths printed */
+};
+
+/* Advance the search from the N nodes in FRONTIER, whose distance is
+   DIST[node], along the edges given by START and ADJ.  Replace the
+   frontier with the nodes reached and return their number.  Update
+   *LEN if any of them has been reached by the opposite search,
+   whose distances are in OTHER. */
+static size_t
+path_advance(size_t *start, size_t *adj, int *dist, int *other,
+	     size_t *frontier, size_t n, size_t *next, int *len)
+{
+     size_t i, j, count = 0;
+
+     for (i = 0; i < n; i++) {
+	  size_t v = frontier[i];
+	  for (j = start[v]; j < start[v+1]; j++) {
+	       size_t w = adj[j];
+	       if (dist[w] >= 0)
+		    continue;
+	       dist[w] = dist[v] + 1;
+	       next[count++] = w;
+	       if (other[w] >= 0 && (*len < 0 || dist[w] + other[w] < *len))
+		    *len = dist[w] + other[w];
+	  }
+     }
+     memcpy(frontier, next, count * sizeof(frontier[0]));
+     return count;
+}
+
+/* Mark the nodes of the shortest paths leading from the start to node V,
+   which is at position POS */
+static void
+mark_prefix(struct path_search *ps, size_t v, int pos)
+{
+     struct graph *g = ps->g;
+     size_t j;
+
+     if (ps->pos[v] >= 0)
+	  return;
+     ps->pos[v] = pos;
+     for (j = g->caller_start[v]; j < g->caller_start[v+1]; j++) {
+	  size_t u = g->caller[j];
+	  if (ps->dist_f[u] >= 0 && ps->dist_f[u] == pos - 1)
+	       mark_prefix(ps, u, pos - 1);
+     }
+}
+
+/* Mark the nodes of the shortest paths leading from node V, which is at
+   position POS, to the target */
+static void
+mark_suffix(struct path_search *ps, size_t v, int pos)
+{
+     struct graph *g = ps->g;
+     size_t j;
+
+     for (j = g->callee_start[v]; j < g->callee_start[v+1]; j++) {
+	  size_t w = g->callee[j];
+	  if (ps->dist_b[w] >= 0 && ps->dist_b[w] == ps->len - pos - 1
+	      && ps->pos[w] < 0) {
+	       ps->pos[w] = pos + 1;
+	       mark_suffix(ps, w, pos + 1);
+	  }
+     }
+}
+
+/* Print the paths continuing the one built so far, whose last node
+   is V at position POS.  Return non-zero to stop. */
+static int
+print_paths(struct path_search *ps, size_t v, int pos)
+{
+     struct graph *g = ps->g;
+     size_t j;
+
+     ps->path[pos] = v;
+     if (pos == ps->len) {
+	  int i;
+
+	  fprintf(outfile, "%s", g->sym[ps->path[0]]->name);
+	  for (i = 1; i <= ps->len; i++)
+	       fprintf(outfile, " -> %s", g->sym[ps->path[i]]->name);
+	  fprintf(outfile, "\n");
+	  STATS_COUNT(STATS_LINE);
+	  ps->count++;
+	  return !all_paths_option;
+     }
+     for (j = g->callee_start[v]; j < g->callee_start[v+1]; j++) {
+	  size_t w = g->callee[j];
+	  if (ps->pos[w] == pos + 1 && print_paths(ps, w, pos + 1))
+	       return 1;
+     }
+     return 0;
+}
+
+/* Print the shortest call paths from FROM to TO */
+static void
+path_query(struct graph *g, char *from, char *to)
+{
+     struct path_search ps;
+     size_t *ff, *fb, *next, nf = 0, nb = 0, i;
+     int pos = 0, found;
+
+     ps.g = g;
+     ps.dist_f = xcalloc(g->count, sizeof(ps.dist_f[0]));
+     ps.dist_b = xcalloc(g->count, sizeof(ps.dist_b[0]));
+     ps.pos = xcalloc(g->count, sizeof(ps.pos[0]));
+     ps.path = NULL;
+     ps.len = -1;
+     ps.count = 0;
+     ff = xcalloc(g->count, sizeof(ff[0]));
+     fb = xcalloc(g->count, sizeof(fb[0]));
+     next = xcalloc(g->count, sizeof(next[0]));
+     for (i = 0; i < g->count; i++) {
+	  ps.dist_f[i] = ps.dist_b[i] = ps.pos[i] = -1;
+	  if (strcmp(g->sym[i]->name, from) == 0) {
+	       ps.dist_f[i] = 0;
+	       ff[nf++] = i;
+	  }
+	  if (strcmp(g->sym[i]->name, to) == 0) {
+	       ps.dist_b[i] = 0;
+	       fb[nb++] = i;
+	       if (ps.dist_f[i] == 0)
+		    ps.len = 0;
+	  }
+     }
+     if (nf == 0)
+	  error(0, 0, _("%s: no such function"), from);
+     if (nb == 0)
+	  error(0, 0, _("%s: no such function"), to);
+     found = nf && nb;
+
+     /* POS keeps the position of the last level reached on the shortest
+	paths.  Each of them passes through a node of that level. */
+     while (ps.len < 0 && nf && nb) {
+	  if (nf <= nb) {
+	       nf = path_advance(g->callee_start, g->callee,
+				 ps.dist_f, ps.dist_b, ff, nf, next, &ps.len);
+	       pos = ps.dist_f[ff[0]];
+	  } else {
+	       nb = path_advance(g->caller_start, g->caller,
+				 ps.dist_b, ps.dist_f, fb, nb, next, &ps.len);
+	       pos = ps.len - ps.dist_b[fb[0]];
+	  }
+     }
+
+     if (ps.len >= 0) {
+	  for (i = 0; i < g->count; i++)
+	       if (ps.dist_f[i] == pos && ps.dist_b[i] == ps.len - pos) {
+		    mark_prefix(&ps, i, pos);
+		    mark_suffix(&ps, i, pos);
+	       }
+	  ps.path = xcalloc(ps.len + 1, sizeof(ps.path[0]));
+	  for (i = 0; i < g->count; i++)
+	       if (ps.pos[i] == 0 && print_paths(&ps, i, 0))
+		    break;
+     } else if (found)
+	  error(0, 0, _("no path from %s to %s"), from, to);
+
+     free(ps.path);
+     free(next);
+     free(fb);
+     free(ff);
+     free(ps.pos);
+     free(ps.dist_b);
+     free(ps.dist_f);
+}
+
+
+/* Recursion groups and levels (--levels).
+
+   The strongly connected components of the graph, i.e. the groups of
+   mutually recursive functions, are found by Tarjan's algorithm, using
+   an explicit stack.  It completes each component after all those it
+   calls, so the level of a component, i.e. the length of the longest
+   chain of calls leading from it to a leaf component, is computed in
+   the same order.  Both steps take linear time. */
+
+/* Find the strongly connected components of G.  Store the component of
+   each node in COMP.  Components are numbered in the order they are
+   completed, so that calls lead from each one only to itself or to
+   lower numbered ones.  Return the number of components. */
+static size_t
+graph_scc(struct graph *g, size_t *comp)
+{
+     size_t *index, *low, *stack, *call, *edge;
+     char *on_stack;
+     size_t counter = 0, sp = 0, cp = 0, ncomp = 0, i;
+
+     index = xcalloc(g->count, sizeof(index[0]));
+     low = xcalloc(g->count, sizeof(low[0]));
+     stack = xcalloc(g->count, sizeof(stack[0]));
+     call = xcalloc(g->count, sizeof(call[0]));
+     edge = xcalloc(g->count, sizeof(edge[0]));
+     on_stack = xzalloc(g->count);
+
+#define VISIT(v) do {					\
+	  index[v] = low[v] = ++counter;		\
+	  stack[sp++] = v;				\
+	  on_stack[v] = 1;				\
+	  call[cp] = v;					\
+	  edge[cp++] = g->callee_start[v];		\
+     } while (0)
+
+     for (i = 0; i < g->count; i++) {
+	  if (index[i])
+	       continue;
+	  VISIT(i);
+	  while (cp) {
+	       size_t v = call[cp-1];
+
+	       if (edge[cp-1] < g->callee_start[v+1]) {
+		    size_t w = g->callee[edge[cp-1]++];
+		    if (!index[w])
+			 VISIT(w);
+		    else if (on_stack[w] && index[w] < low[v])
+			 low[v] = index[w];
+		    continue;
+	       }
+
+	       cp--;
+	       if (low[v] == index[v]) {
+		    size_t w;
+		    do {
+			 w = stack[--sp];
+			 on_stack[w] = 0;
+			 comp[w] = ncomp;
+		    } while (w != v);
+		    ncomp++;
+	       }
+	       if (cp && low[v] < low[call[cp-1]])
+		    low[call[cp-1]] = low[v];
+	  }
+     }
+#undef VISIT
+
+     free(on_stack);
+     free(edge);
+     free(call);
+     free(stack);
+     free(low);
+     free(index);
+     return ncomp;
+}
+
+/* Mark the nodes of G that are part of a cycle of calls as recursive */
+static void
+graph_mark_recursive(struct graph *g)
+{
+     size_t *comp, *size, ncomp, i, j;
+
+     comp = xcalloc(g->count, sizeof(comp[0]));
+     ncomp = graph_scc(g, comp);
+     size = xcalloc(ncomp, sizeof(size[0]));
+     for (i = 0; i < g->count; i++)
+	  size[comp[i]]++;
+     for (i = 0; i < g->count; i++) {
+	  g->sym[i]->recursive = size[comp[i]] > 1;
+	  for (j = g->callee_start[i]; j < g->callee_start[i+1]; j++)
+	       if (g->callee[j] == i)
+		    g->sym[i]->recursive = 1;
+     }
+     free(size);
+     free(comp);
+}
+
+struct level_entry {
+     size_t comp;           /* Component */
+     size_t first;          /* Its first node */
+     int level;             /* Its level */
+};
+
+static int
+compare_levels(const void *ap, const void *bp)
+{
+     const struct level_entry *a = ap;
+     const struct level_entry *b = bp;
+     if (a->level != b->level)
+	  return a->level - b->level;
+     return a->first < b->first ? -1 : a->first > b->first;
+}
+
+/* Print the level of each group of mutually recursive functions,
+   followed by the names of its functions, in the order of levels */
+static void
+levels_output(struct graph *g)
+{
+     size_t *comp, *start, *member, ncomp, i, j;
+     struct level_entry *ent;
+
+     comp = xcalloc(g->count, sizeof(comp[0]));
+     ncomp = graph_scc(g, comp);
+
+     /* List the members of each component, in the order of nodes */
+     start = xcalloc(ncomp + 1, sizeof(start[0]));
+     member = xcalloc(g->count + 1, sizeof(member[0]));
+     for (i = 0; i < g->count; i++)
+	  start[comp[i] + 1]++;
+     for (i = 1; i <= ncomp; i++)
+	  start[i] += start[i-1];
+     for (i = 0; i < g->count; i++)
+	  member[start[comp[i]]++] = i;
+     for (i = ncomp; i > 0; i--)
+	  start[i] = start[i-1];
+     start[0] = 0;
+
+     ent = xcalloc(ncomp + 1, sizeof(ent[0]));
+     for (i = 0; i < ncomp; i++) {
+	  ent[i].comp = i;
+	  ent[i].first = member[start[i]];
+	  ent[i].level = 0;
+	  for (j = start[i]; j < start[i+1]; j++) {
+	       size_t v = member[j], k;
+	       for (k = g->callee_start[v]; k < g->callee_start[v+1]; k++) {
+		    size_t c = comp[g->callee[k]];
+		    if (c != i && ent[c].level >= ent[i].level)
+			 ent[i].level = ent[c].level + 1;
+	       }
+	  }
+     }
+
+     qsort(ent, ncomp, sizeof(ent[0]), compare_levels);
+     for (i = 0; i < ncomp; i++) {
+	  size_t c = ent[i].comp;
+
+	  fprintf(outfile, "%d", ent[i].level);
+	  for (j = start[c]; j < start[c+1]; j++)
+	       fprintf(outfile, " %s", g->sym[member[j]]->name);
+	  fprintf(outfile, "\n");
+	  STATS_COUNT(STATS_LINE);
+     }
+
+     free(ent);
+     free(member);
+     free(start);
+     free(comp);
+}
+
+
+/* Dominator tree (--dominators).
+
+   A function D dominates a function F if every chain of calls leading
+   from the start function to F passes through D.  The immediate
+   dominators are computed by the Lengauer-Tarjan algorithm, using
+   path compression, in O(E log V) time.  Nodes are referred to by
+   their depth-first numbers throughout. */
+
+#define NONE ((size_t)-1)
+
+struct dominators {
+     size_t *semi;          /* Semidominator of each node */
+     size_t *ancestor;      /* Ancestor in the forest being linked */
+     size_t *label;         /* Node with the least semidominator on the
+				path to the ancestor */
+     size_t *stack;         /* Work stack for compress */
+};
+
+/* Compress the ancestor path of V, updating the labels */
+static void
+dom_compress(struct dominators *d, size_t v)
+{
+     size_t n = 0;
+
+     while (d->ancestor[d->ancestor[v]] != NONE) {
+	  d->stack[n++] = v;
+	  v = d->ancestor[v];
+     }
+     while (n--) {
+	  size_t a;
+
+	  v = d->stack[n];
+	  a = d->ancestor[v];
+	  if (d->semi[d->label[a]] < d->semi[d->label[v]])
+	       d->label[v] = d->label[a];
+	  d->ancestor[v] = d->ancestor[a];
+     }
+}
+
+static size_t
+dom_eval(struct dominators *d, size_t v)
+{
+     if (d->ancestor[v] == NONE)
+	  return v;
+     dom_compress(d, v);
+     return d->label[v];
+}
+
+static int
+compare_tree_nodes(const void *ap, const void *bp)
+{
+     const size_t *a = ap;
+     const size_t *b = bp;
+     return *a < *b ? -1 : *a > *b;
+}
+
+/* Compute the dominator tree of the graph built from the callee lists,
+   rooted at the function start_name.  Store in *RET the array of its
+   nodes in the order of output, with their levels in the tree, and
+   return their number.  Levels are limited by max_depth.  Recursive
+   functions are marked as such on the way. */
+size_t
+dominator_tree(struct output_symbol **ret)
+{
+     struct graph g;
+     struct dominators d;
+     size_t *dfnum, *vertex, *parent, *idom, *bucket, *next_in_bucket;
+     size_t *edge, *kids, *kid_start, *stk;
+     struct output_symbol *out;
+     size_t root, n, i, j, sp;
+
+     *ret = NULL;
+     graph_build(&g);
+     graph_mark_recursive(&g);
+     for (root = 0; root < g.count; root++)
+	  if (strcmp(g.sym[root]->name, start_name) == 0)
+	       break;
+     if (root == g.count) {
+	  error(0, 0, _("%s: no such function"), start_name);
+	  graph_free(&g);
+	  return 0;
+     }
+
+     dfnum = xcalloc(g.count, sizeof(dfnum[0]));
+     vertex = xcalloc(g.count, sizeof(vertex[0]));
+     parent = xcalloc(g.count, sizeof(parent[0]));
+     edge = xcalloc(g.count, sizeof(edge[0]));
+     stk = xcalloc(g.count, sizeof(stk[0]));
+     for (i = 0; i < g.count; i++)
+	  dfnum[i] = NONE;
+
+     /* Number the nodes reachable from the root in depth-first order */
+     n = 0;
+     sp = 0;
+     dfnum[root] = n;
+     vertex[n] = root;
+     parent[n++] = NONE;
+     stk[sp] = root;
+     edge[sp++] = g.callee_start[root];
+     while (sp) {
+	  size_t v = stk[sp-1];
+	  if (edge[sp-1] < g.callee_start[v+1]) {
+	       size_t w = g.callee[edge[sp-1]++];
+	       if (dfnum[w] == NONE) {
+		    dfnum[w] = n;
+		    vertex[n] = w;
+		    parent[n++] = dfnum[v];
+		    stk[sp] = w;
+		    edge[sp++] = g.callee_start[w];
+	       }
+	  } else
+	       sp--;
+     }
+
+     d.semi = xcalloc(n, sizeof(d.semi[0]));
+     d.ancestor = xcalloc(n, sizeof(d.ancestor[0]));
+     d.label = xcalloc(n, sizeof(d.label[0]));
+     d.stack = xcalloc(n, sizeof(d.stack[0]));
+     idom = xcalloc(n, sizeof(idom[0]));
+     bucket = xcalloc(n, sizeof(bucket[0]));
+     next_in_bucket = xcalloc(n, sizeof(next_in_bucket[0]));
+     for (i = 0; i < n; i++) {
+	  d.semi[i] = d.label[i] = i;
+	  d.ancestor[i] = bucket[i] = NONE;
+     }
+
+     for (i = n; i-- > 1; ) {
+	  size_t w = vertex[i], p = parent[i], v;
+
+	  /* Compute the semidominator of I */
+	  for (j = g.caller_start[w]; j < g.caller_start[w+1]; j++) {
+	       size_t u = dfnum[g.caller[j]];
+	       if (u == NONE)
+		    continue;
+	       u = dom_eval(&d, u);
+	       if (d.semi[u] < d.semi[i])
+		    d.semi[i] = d.semi[u];
+	  }
+	  next_in_bucket[i] = bucket[d.semi[i]];
+	  bucket[d.semi[i]] = i;
+	  d.ancestor[i] = p;
+
+	  /* Implicitly compute the immediate dominators of the nodes
+	     whose semidominator is the parent of I */
+	  for (v = bucket[p]; v != NONE; v = next_in_bucket[v]) {
+	       size_t u = dom_eval(&d, v);
+	       idom[v] = d.semi[u] < d.semi[v] ? u : p;
+	  }
+	  bucket[p] = NONE;
+     }
+     idom[0] = NONE;
+     for (i = 1; i < n; i++)
+	  if (idom[i] != d.semi[i])
+	       idom[i] = idom[idom[i]];
+
+     /* List the children of each node, in the order of nodes */
+     kid_start = xcalloc(n + 1, sizeof(kid_start[0]));
+     kids = xcalloc(n + 1, sizeof(kids[0]));
+     for (i = 1; i < n; i++)
+	  kid_start[idom[i] + 1]++;
+     for (i = 1; i <= n; i++)
+	  kid_start[i] += kid_start[i-1];
+     for (i = 1; i < n; i++)
+	  kids[kid_start[idom[i]]++] = vertex[i];
+     for (i = n; i > 0; i--)
+	  kid_start[i] = kid_start[i-1];
+     kid_start[0] = 0;
+     for (i = 0; i < n; i++)
+	  qsort(kids + kid_start[i], kid_start[i+1] - kid_start[i],
+		sizeof(kids[0]), compare_tree_nodes);
+
+     /* Produce the preorder walk of the tree */
+     out = xcalloc(n, sizeof(out[0]));
+     j = 0;
+     sp = 0;
+     stk[sp] = 0;
+     edge[sp++] = kid_start[0];
+     out[j].direct = 1;
+     out[j].level = 0;
+     out[j].last = 0;
+     out[j++].sym = g.sym[root];
+     while (sp) {
+	  size_t v = stk[sp-1];
+	  if (edge[sp-1] < kid_start[v+1] && (!max_depth || sp < max_depth)) {
+	       size_t w = dfnum[kids[edge[sp-1]++]];
+	       out[j].direct = 1;
+	       out[j].level = sp;
+	       out[j].last = edge[sp-1] == kid_start[v+1];
+	       out[j++].sym = g.sym[vertex[w]];
+	       stk[sp] = w;
+	       edge[sp++] = kid_start[w];
+	  } else
+	       sp--;
+     }
+     *ret = out;
+
+     free(kids);
+     free(kid_start);
+     free(next_in_bucket);
+     free(bucket);
+     free(idom);
+     free(d.stack);
+     free(d.label);
+     free(d.ancestor);
+     free(d.semi);
+     free(stk);
+     free(edge);
+     free(parent);
+     free(vertex);
+     free(dfnum);
+     graph_free(&g);
+     return j;
+}
+
+/* Answer the graph queries given in the command line */
+void
+query_output()
+{
+     struct graph g;
+     struct linked_list_entry *p;
+
+     graph_build(&g);
+     if (levels_option)
+	  levels_output(&g);
+     reach_list(&g, 0, reachable_from);
+     reach_list(&g, 1, reaches);
+     for (p = linked_list_head(path_list); p; p = p->next) {
+	  char *from = xstrdup(p->data);
+	  char *to = strchr(from, ':');
+
+	  if (!to) {
+	       error(0, 0, _("%s: expected FROM:TO"), from);
+	       free(from);
+	       continue;
+	  }
+	  *to++ = 0;
+	  path_query(&g, from, to);
+	  free(from);
+     }
+     graph_free(&g);
+}
+
+/* Return true if any graph queries were requested */
+int
+query_requested()
+{
+     return levels_option || reachable_from || reaches || path_list;
+}
@@ -0,0 +1,147 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Header region cache (--cache-headers).
+
+   A header region is a part of the preprocessed input that comes from
+   the headers included by the primary source file, i.e. the text
+   between the line marker that enters a header from the primary file
+   and the one that returns to it.  The scanner tells the parser where
+   regions begin and end (see TOKEN_REGION_BEGIN and TOKEN_REGION_END),
+   and computes the hash of the tokens of each region, along with their
+   line numbers and file names.
+
+   When a region is parsed, the facts it produces (see factdb.c) are
+   recorded.  If a region with the same name and hash is met again,
+   e.g. in another compilation unit, its tokens are dropped and the
+   recorded facts are replayed instead.  The cache lives as long as
+   the program runs. */
+
+#include <cflow.h>
+#include <parser.h>
+#include <hash.h>
+
+struct region {
+     cache_hash_t hash;  /* Hash of the tokens */
+     char *name;         /* Name of the file the region begins in */
+     char *text;         /* Recorded facts */
+     size_t size;        /* Size of text, including the terminating 0 */
+};
+
+static Hash_table *region_table;
+static FILE *record_fp;          /* Stream facts are recorded to */
+static struct region record;     /* The region being recorded */
+
+static size_t
+region_hasher(void const *data, size_t n_buckets)
+{
+     struct region const *rp = data;
+     return rp->hash % n_buckets;
+}
+
+static bool
+region_compare(void const *data1, void const *data2)
+{
+     struct region const *r1 = data1;
+     struct region const *r2 = data2;
+     return r1->hash == r2->hash && strcmp(r1->name, r2->name) == 0;
+}
+
+/* Replay the facts cached for the header region with the given HASH,
+   which begins in the file NAME.  Return 0 on success, and -1 if the
+   region is not in the cache. */
+int
+hdrcache_replay(char *name, cache_hash_t hash)
+{
+     static char *text;       /* Scratch copy of the facts */
+     static size_t text_size;
+     struct region key, *rp;
+
+     key.hash = hash;
+     key.name = name;
+     if (!region_table || (rp = hash_lookup(region_table, &key)) == NULL) {
+	  STATS_COUNT(STATS_HDR_MISS);
+	  return -1;
+     }
+     STATS_COUNT(STATS_HDR_HIT);
+     if (debug)
+	  fprintf(stderr, _("%s:%d: using cached header region\n"),
+		  name, line_num);
+     /* Replaying modifies the text, so it is done on a copy, which is
+	reused for the next region */
+     if (text_size < rp->size) {
+	  text_size = rp->size;
+	  text = xrealloc(text, text_size);
+     }
+     memcpy(text, rp->text, rp->size);
+     if (replay_region(text, rp->name) == NULL)
+	  error(EX_FATAL, 0, _("INTERNAL ERROR: malformed header cache entry"));
+     return 0;
+}
+
+/* Start recording the facts of the header region with the given HASH,
+   which begins in the file NAME */
+void
+hdrcache_record_begin(char *name, cache_hash_t hash)
+{
+     if (!record_fp) {
+	  record_fp = tmpfile();
+	  if (!record_fp)
+	       error(EX_FATAL, errno, _("cannot create temporary file"));
+     } else
+	  rewind(record_fp);
+     record.hash = hash;
+     record.name = name;
+     facts_begin_region(record_fp);
+}
+
+/* Stop recording.  If STORE is not 0, the region has been parsed
+   completely: add it to the cache. */
+void
+hdrcache_record_end(int store)
+{
+     struct region *rp;
+     long size;
+
+     facts_end();
+     if (!store)
+	  return;
+     size = ftell(record_fp);
+     if (size < 0)
+	  return;
+     rp = xmalloc(sizeof *rp);
+     rp->hash = record.hash;
+     rp->name = xstrdup(record.name);
+     rp->size = size + 1;
+     rp->text = xmalloc(rp->size);
+     rewind(record_fp);
+     if (fread(rp->text, 1, size, record_fp) != (size_t) size) {
+	  error(0, errno, _("cannot read temporary file"));
+	  free(rp->text);
+	  free(rp->name);
+	  free(rp);
+	  return;
+     }
+     rp->text[size] = 0;
+     if (!((region_table
+	    || (region_table = hash_initialize(0, 0,
+					       region_hasher,
+					       region_compare, 0)))
+	   && hash_insert(region_table, rp)))
+	  xalloc_die();
+     if (debug)
+	  fprintf(stderr, _("%s: header region cached\n"), rp->name);
+}
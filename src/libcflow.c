@@ -0,0 +1,311 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Implementation of the libcflow interface (see libcflow.h).
+
+   The scanner, the parser, the symbol table and the output drivers keep
+   their state in global variables, which are never reset, so the
+   library serves a single set of sources per process. */
+
+#include <cflow.h>
+#include <libcflow.h>
+#include <parser.h>
+
+static int lib_initialized;    /* cflow_init has been called */
+static int parser_initialized; /* The scanner and parser have been
+				  initialized */
+
+void
+cflow_init()
+{
+     if (lib_initialized)
+	  return;
+     lib_initialized = 1;
+     stats_init();
+
+     register_output("gnu", gnu_output_handler, NULL);
+     register_output("posix", posix_output_handler, NULL);
+
+     if (getenv("POSIXLY_CORRECT")) {
+	  if (select_output_driver("posix")) {
+	       error(0, 0, _("INTERNAL ERROR: %s: No such output driver"),
+		     "posix");
+	       abort();
+	  }
+	  output_init();
+     }
+}
+
+/* Initialize the scanner and parser, once all options are set */
+static void
+parser_init()
+{
+     if (!parser_initialized) {
+	  if (print_option == 0)
+	       print_option = PRINT_TREE;
+	  init();
+	  parser_initialized = 1;
+     }
+}
+
+/* Parse all compilation units from the current input file.  In --stream
+   mode, produce the output for each of them as soon as it is parsed. */
+void
+parse_input()
+{
+     int more;
+
+     do {
+	  stats_phase(STATS_PARSE);
+	  yyparse();
+	  more = next_unit();
+	  if (stream_option)
+	       output_unit();
+     } while (more);
+}
+
+/* Process the source file NAME.  Return 0 on success. */
+static int
+process_file(char *name)
+{
+     /* Standard input and pipes can be read only once: they are neither
+	watched nor kept in the fact database */
+     int stream = input_is_stream(name);
+
+     if (watch_option) {
+	  if (stream) {
+	       error(0, 0, _("cannot watch `%s'"), name);
+	       return 1;
+	  }
+	  watch_add(name);
+	  return 0;
+     }
+     if (merge_option)
+	  return merge_facts(name);
+     if (db_dir && !emit_facts_option && !stream && factdb_replay(name) == 0)
+	  return 0;
+     if (source(name))
+	  return 1;
+     if (emit_facts_option) {
+	  emit_facts_begin(name);
+	  parse_input();
+	  facts_end();
+     } else if (db_dir && !stream) {
+	  factdb_record_begin(name);
+	  parse_input();
+	  factdb_record_end(name);
+     } else
+	  parse_input();
+     return 0;
+}
+
+/* Return the next name from the list DATA, for ccdb_parallel */
+static char *
+list_next(void *data)
+{
+     return filelist_next(data);
+}
+
+/* Process the files from the list FL (see filelist.c) and close it.
+   When the files are to be preprocessed and --jobs is given, run the
+   preprocessors in parallel.  Return 0 on success. */
+static int
+process_list(struct filelist *fl)
+{
+     char *s;
+     int status = 0;
+
+     if (preprocess_option && max_jobs > 1 && !watch_option && !merge_option
+	 && !db_dir && !emit_facts_option && !cache_dir)
+	  status = ccdb_parallel(list_next, fl);
+     else
+	  while ((s = filelist_next(fl)) != NULL)
+	       if (process_file(s))
+		    status = 1;
+     if (filelist_close(fl))
+	  status = 1;
+     return status;
+}
+
+int
+cflow_parse_options(int argc, char **argv, int *index)
+{
+     struct linked_list_entry *p;
+     struct linked_list *walk_list = NULL;
+     struct filelist *fl;
+     int status = 0;
+
+     if (parse_options(argc, argv, index))
+	  return -1;
+     stats_phase(STATS_PARSE);
+     parser_init();
+     /* Start searching the directories given with --recursive at once,
+	so that the search proceeds while the other files are parsed */
+     for (p = linked_list_head(recurse_list); p; p = p->next)
+	  if ((fl = walk_start(p->data)) != NULL)
+	       linked_list_append(&walk_list, fl);
+	  else
+	       status = 1;
+     for (p = linked_list_head(arglist); p; p = p->next) {
+	  char *s = (char*)p->data;
+	  /* A lone `-' stands for the standard input */
+	  if (s[0] == '-' && s[1])
+	       pp_option(s);
+	  else if (s[0] == '@' && s[1]) {
+	       if ((fl = filelist_open(s + 1)) == NULL || process_list(fl))
+		    status = 1;
+	  } else if (process_file(s))
+	       status = 1;
+     }
+     linked_list_destroy(&arglist);
+     for (p = linked_list_head(walk_list); p; p = p->next)
+	  if (process_list(p->data))
+	       status = 1;
+     linked_list_destroy(&walk_list);
+     return status;
+}
+
+int
+cflow_add_file(const char *name)
+{
+     parser_init();
+     return process_file(xstrdup(name));
+}
+
+int
+cflow_add_buffer(const char *name, const char *buf, size_t size)
+{
+     FILE *fp;
+
+     parser_init();
+     fp = fmemopen((void*) buf, size, "r");
+     if (!fp) {
+	  error(0, errno, _("cannot open `%s'"), name);
+	  return 1;
+     }
+     source_stream(xstrdup(name), fp);
+     parse_input();
+     return 0;
+}
+
+int
+cflow_finish()
+{
+     int rc, status = 0;
+
+     parser_init();
+     while ((rc = ccdb_source()) != -1) {
+	  if (rc == 0)
+	       parse_input();
+	  else
+	       status = 1;
+     }
+     ppcache_finish();
+     return status;
+}
+
+/* Fill INFO with the description of the symbol SYM */
+static void
+symbol_info(Symbol *sym, struct cflow_symbol *info)
+{
+     info->name = sym->name;
+     info->decl = sym->source ? symbol_decl(sym) : NULL;
+     info->source = sym->source;
+     info->line = sym->source ? sym->def_line : -1;
+     info->flags = 0;
+     if (symbol_is_function(sym))
+	  info->flags |= CFLOW_SYMBOL_FUNCTION;
+     if (sym->storage == StaticStorage)
+	  info->flags |= CFLOW_SYMBOL_STATIC;
+}
+
+static int
+compare(const void *ap, const void *bp)
+{
+     Symbol * const *a = ap;
+     Symbol * const *b = bp;
+     return strcmp((*a)->name, (*b)->name);
+}
+
+static int
+is_listed(Symbol *sym)
+{
+     return sym->type == SymIdentifier && sym->storage != AutoStorage
+	    && include_symbol(sym);
+}
+
+int
+cflow_iterate_symbols(cflow_symbol_fn fn, void *data)
+{
+     Symbol **symbols;
+     size_t i, num;
+     int rc = 0;
+
+     parser_init();
+     num = collect_symbols(&symbols, is_listed, 0);
+     qsort(symbols, num, sizeof(*symbols), compare);
+     for (i = 0; i < num && rc == 0; i++) {
+	  struct cflow_symbol info;
+
+	  symbol_info(symbols[i], &info);
+	  rc = fn(&info, data);
+     }
+     free(symbols);
+     return rc;
+}
+
+int
+cflow_iterate_edges(cflow_edge_fn fn, void *data)
+{
+     Symbol **symbols;
+     size_t i, num;
+     int rc = 0;
+
+     parser_init();
+     num = collect_symbols(&symbols, is_listed, 0);
+     qsort(symbols, num, sizeof(*symbols), compare);
+     for (i = 0; i < num && rc == 0; i++) {
+	  struct cflow_symbol caller;
+	  struct linked_list_entry *p;
+
+	  symbol_info(symbols[i], &caller);
+	  for (p = linked_list_head(symbols[i]->callee); p && rc == 0;
+	       p = p->next) {
+	       Symbol *sym = p->data;
+	       struct cflow_symbol callee;
+
+	       if (!is_listed(sym))
+		    continue;
+	       symbol_info(sym, &callee);
+	       rc = fn(&caller, &callee, data);
+	  }
+     }
+     free(symbols);
+     return rc;
+}
+
+int
+cflow_output(const char *driver, FILE *sink)
+{
+     parser_init();
+     if (driver) {
+	  if (select_output_driver(driver))
+	       return -1;
+	  output_init();
+     }
+     output_stream(sink);
+     return 0;
+}
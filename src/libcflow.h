@@ -0,0 +1,104 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Interface to libcflow, the library implementing GNU cflow.
+
+   A typical use is:
+
+     cflow_init();
+     cflow_parse_options(argc, argv, NULL);
+     cflow_add_file("foo.c");
+     cflow_finish();
+     cflow_iterate_edges(print_edge, NULL);
+     cflow_output("gnu", stdout);
+
+   The scanner, the parser, the symbol table and the output drivers keep
+   their state in global variables.  Therefore the library handles a
+   single set of sources per process, which accumulates until the
+   process exits, and its functions may be called by one thread at a
+   time.  Only a static library is built.  Fatal errors (e.g. memory
+   exhaustion) terminate the process. */
+
+#ifndef _LIBCFLOW_H
+#define _LIBCFLOW_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Symbol flags */
+#define CFLOW_SYMBOL_FUNCTION 0x01 /* Symbol is a function */
+#define CFLOW_SYMBOL_STATIC   0x02 /* Symbol has static storage */
+
+struct cflow_symbol {
+     const char *name;    /* Symbol name */
+     const char *decl;    /* Declaration, or NULL if not defined */
+     const char *source;  /* Source file of the definition, or NULL */
+     int line;            /* Line of the definition, or -1 */
+     int flags;           /* CFLOW_SYMBOL_ flags */
+};
+
+/* Iterator callbacks.  A non-zero return stops the iteration. */
+typedef int (*cflow_symbol_fn) (const struct cflow_symbol *sym,
+				void *data);
+typedef int (*cflow_edge_fn) (const struct cflow_symbol *caller,
+			      const struct cflow_symbol *callee,
+			      void *data);
+
+/* Initialize the library.  This must be called before any other
+   function.  Calling it again has no effect. */
+void cflow_init(void);
+
+/* Set options from the command line ARGV (ARGV[0] is the program name),
+   as the cflow utility does, and add the source files named in it,
+   including those listed in the files given as @FILE or --files-from.
+   If INDEX is not NULL, store there the index of the first argument
+   not processed.  Return 0 on success, -1 if the options are invalid,
+   and 1 if some of the source files or lists could not be read. */
+int cflow_parse_options(int argc, char **argv, int *index);
+
+/* Parse the source file NAME.  Return 0 on success. */
+int cflow_add_file(const char *name);
+
+/* Parse SIZE bytes from BUF, as if they were contents of the source file
+   NAME.  The contents are not preprocessed.  Return 0 on success. */
+int cflow_add_buffer(const char *name, const char *buf, size_t size);
+
+/* Finish adding sources, processing compilation database entries, if
+   any.  Return 0 on success, and 1 if some of them failed. */
+int cflow_finish(void);
+
+/* Call FN for each symbol selected for output, in alphabetical order.
+   Return the last value returned by FN. */
+int cflow_iterate_symbols(cflow_symbol_fn fn, void *data);
+
+/* Call FN for each call of one symbol selected for output from another,
+   ordered by the caller's name, then in the order of calls.  Return the
+   last value returned by FN. */
+int cflow_iterate_edges(cflow_edge_fn fn, void *data);
+
+/* Produce the output selected by the options using the output driver
+   DRIVER (the current one, if NULL) and write it to SINK.  Return 0 on
+   success, and -1 if there is no such driver. */
+int cflow_output(const char *driver, FILE *sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1125 @@
+/* This file is part of GNU cflow
+   Copyright (C) 1997, 2005, 2007, 2009-2011, 2014-2017 Sergey
+   Poznyakoff
+ 
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+ 
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cflow.h>
+#include <argp.h>
+#include <stdint.h>
+#include <parser.h>
+
+static char doc[] = N_("generate a program flowgraph")
+"\v"
+N_("* The effect of each option marked with an asterisk is reversed if the option's long name is prefixed with `no-'. For example, --no-cpp cancels --cpp.");
+
+enum option_code {
+     OPT_DEFINES = 256,
+     OPT_LEVEL_INDENT,
+     OPT_DEBUG,
+     OPT_PREPROCESS,
+     OPT_NO_PREPROCESS,
+     OPT_EMACS,
+     OPT_NO_USE_INDENTATION,
+     OPT_NO_ANSI,
+     OPT_NO_TREE,
+     OPT_NO_BRIEF,
+     OPT_NO_EMACS,
+     OPT_NO_VERBOSE,
+     OPT_NO_NUMBER,
+     OPT_NO_PRINT_LEVEL,
+     OPT_NO_REVERSE,
+     OPT_OMIT_ARGUMENTS,
+     OPT_NO_OMIT_ARGUMENTS,
+     OPT_OMIT_SYMBOL_NAMES,
+     OPT_NO_OMIT_SYMBOL_NAMES,
+     OPT_SPLIT_UNITS,
+     OPT_NO_SPLIT_UNITS,
+     OPT_COMPILE_COMMANDS,
+     OPT_FILES_FROM,
+     OPT_MATCH,
+     OPT_EXCLUDE,
+     OPT_CACHE_DIR,
+     OPT_CACHE_SIZE,
+     OPT_CACHE_STATS,
+     OPT_DB,
+     OPT_EMIT_FACTS,
+     OPT_MERGE,
+     OPT_SERVE,
+     OPT_WATCH,
+     OPT_REACHABLE_FROM,
+     OPT_REACHES,
+     OPT_PATH,
+     OPT_ALL_PATHS,
+     OPT_AVOID,
+     OPT_LEVELS,
+     OPT_DOMINATORS,
+     OPT_STATS,
+     OPT_SKIM_HEADERS,
+     OPT_NO_SKIM_HEADERS,
+     OPT_CACHE_HEADERS,
+     OPT_NO_CACHE_HEADERS,
+     OPT_STREAM,
+     OPT_NO_STREAM
+};
+
+static struct argp_option options[] = {
+#define GROUP_ID 0
+     { NULL, 0, NULL, 0,
+       N_("General options:"), GROUP_ID },
+     { "depth", 'd', N_("NUMBER"), 0,
+       N_("Set the depth at which the flowgraph is cut off"), GROUP_ID+1 },
+     { "include", 'i', N_("CLASSES"), 0,
+       N_("Include specified classes of symbols (see below). Prepend CLASSES with ^ or - to exclude them from the output"), GROUP_ID+1 },
+     { "format", 'f', N_("NAME"), 0,
+       N_("Use given output format NAME. Valid names are `gnu' (default) and `posix'"),
+       GROUP_ID+1 },
+     { "reverse", 'r', NULL, 0,
+       N_("* Print reverse call tree"), GROUP_ID+1 },
+     { "dominators", OPT_DOMINATORS, NULL, 0,
+       N_("Print the dominator tree of the main function instead of its call tree"),
+       GROUP_ID+1 },
+     { "xref", 'x', NULL, 0,
+       N_("Produce cross-reference listing only"), GROUP_ID+1 },
+     { "reachable-from", OPT_REACHABLE_FROM, N_("FUNCTION"), 0,
+       N_("Print the functions reachable from FUNCTION, with their distances from it, instead of the graph"),
+       GROUP_ID+1 },
+     { "reaches", OPT_REACHES, N_("FUNCTION"), 0,
+       N_("Print the functions from which FUNCTION is reachable, with their distances to it, instead of the graph"),
+       GROUP_ID+1 },
+     { "levels", OPT_LEVELS, NULL, 0,
+       N_("Print the groups of mutually recursive functions and the level of each, instead of the graph"),
+       GROUP_ID+1 },
+     { "path", OPT_PATH, N_("FROM:TO"), 0,
+       N_("Print a shortest call path from function FROM to function TO, instead of the graph"),
+       GROUP_ID+1 },
+     { "all-paths", OPT_ALL_PATHS, NULL, 0,
+       N_("Print all shortest paths with --path"), GROUP_ID+1 },
+     { "avoid", OPT_AVOID, N_("FUNCTION"), 0,
+       N_("Ignore calls to and from FUNCTION in --path, --reachable-from and --reaches"),
+       GROUP_ID+1 },
+     { "print", 'P', N_("OPT"), OPTION_HIDDEN,
+       N_("Set printing option to OPT. Valid OPT values are: xref (or cross-ref), tree. Any unambiguous abbreviation of the above is also accepted"),
+       GROUP_ID+1 },
+     { "output", 'o', N_("FILE"), 0,
+       N_("Set output file name (default -, meaning stdout)"),
+       GROUP_ID+1 },
+     { "stream", OPT_STREAM, NULL, 0,
+       N_("* Produce the output for each compilation unit as soon as it is parsed, treating units as separate programs"),
+       GROUP_ID+1 },
+     { "no-stream", OPT_NO_STREAM, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+
+     { NULL, 0, NULL, 0, N_("Symbols classes for --include argument"), GROUP_ID+2 },
+     {"  x", 0, NULL, OPTION_DOC|OPTION_NO_TRANS,
+      N_("all data symbols, both external and static"), GROUP_ID+3 },
+     {"  _",  0, NULL, OPTION_DOC|OPTION_NO_TRANS,
+      N_("symbols whose names begin with an underscore"), GROUP_ID+3 },
+     {"  s",  0, NULL, OPTION_DOC|OPTION_NO_TRANS,
+      N_("static symbols"), GROUP_ID+3 },
+     {"  t",  0, NULL, OPTION_DOC|OPTION_NO_TRANS,
+      N_("typedefs (for cross-references only)"), GROUP_ID+3 },
+
+     
+#undef GROUP_ID
+#define GROUP_ID 10     
+     { NULL, 0, NULL, 0,
+       N_("Parser control:"), GROUP_ID },
+     { "use-indentation", 'S', NULL, 0,
+       N_("* Rely on indentation"), GROUP_ID+1 },
+     { "no-use-indentation", OPT_NO_USE_INDENTATION, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "ansi", 'a', NULL, 0,
+       N_("* Accept only sources in ANSI C"), GROUP_ID+1 },
+     { "no-ansi", OPT_NO_ANSI, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "pushdown", 'p', N_("NUMBER"), 0,
+       N_("Set initial token stack size to NUMBER"), GROUP_ID+1 },
+     { "symbol", 's', N_("SYMBOL:[=]TYPE"), 0,
+       N_("Register SYMBOL with given TYPE, or define an alias (if := is used). Valid types are: keyword (or kw), modifier, qualifier, identifier, type, wrapper. Any unambiguous abbreviation of the above is also accepted"), GROUP_ID+1 },
+     { "main", 'm', N_("NAME"), 0,
+       N_("Assume main function to be called NAME"), GROUP_ID+1 },
+     { "define", 'D', N_("NAME[=DEFN]"), 0,
+       N_("Predefine NAME as a macro"), GROUP_ID+1 },
+     { "undefine", 'U', N_("NAME"), 0,
+       N_("Cancel any previous definition of NAME"), GROUP_ID+1 },
+     { "include-dir", 'I', N_("DIR"), 0,
+       N_("Add the directory DIR to the list of directories to be searched for header files."), GROUP_ID+1 },
+     { "preprocess", OPT_PREPROCESS, N_("COMMAND"), OPTION_ARG_OPTIONAL,
+       N_("* Run the specified preprocessor command"), GROUP_ID+1 },
+     { "cpp", 0, NULL, OPTION_ALIAS, NULL, GROUP_ID+1 },
+     { "no-preprocess", OPT_NO_PREPROCESS, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "no-cpp", 0, NULL, OPTION_ALIAS|OPTION_HIDDEN, NULL, GROUP_ID+1 },
+     { "split-units", OPT_SPLIT_UNITS, N_("KIND"), OPTION_ARG_OPTIONAL,
+       N_("* Input files are preprocessed streams containing several compilation units. KIND tells how unit boundaries are marked: `markers' (line markers of primary source files, the default) or `pragma' (only `#pragma cflow unit' lines)"),
+       GROUP_ID+1 },
+     { "no-split-units", OPT_NO_SPLIT_UNITS, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "skim-headers", OPT_SKIM_HEADERS, N_("PREFIX"), OPTION_ARG_OPTIONAL,
+       N_("* Only register typedefs from header files whose names begin with PREFIX (default: /usr/include), skipping other declarations and function bodies in them. May be given several times"),
+       GROUP_ID+1 },
+     { "no-skim-headers", OPT_NO_SKIM_HEADERS, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "cache-headers", OPT_CACHE_HEADERS, NULL, 0,
+       N_("* Parse the text included from header files only once per run: when the same text is included again by another compilation unit, replay the result of parsing it"),
+       GROUP_ID+1 },
+     { "no-cache-headers", OPT_NO_CACHE_HEADERS, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "compile-commands", OPT_COMPILE_COMMANDS, N_("FILE"), 0,
+       N_("Read the list of source files and their preprocessor options from the compilation database FILE (compile_commands.json)"),
+       GROUP_ID+1 },
+     { "files-from", OPT_FILES_FROM, N_("FILE"), 0,
+       N_("Read the names of source files from FILE, one per line or separated by NUL characters (`-' means standard input). An argument @FILE is equivalent"),
+       GROUP_ID+1 },
+     { "recursive", 'R', N_("DIR"), 0,
+       N_("Search the directory DIR and its subdirectories for source files"),
+       GROUP_ID+1 },
+     { "match", OPT_MATCH, N_("PATTERN"), 0,
+       N_("With --recursive, look for files matching PATTERN (default: *.c and *.h). May be given several times"),
+       GROUP_ID+1 },
+     { "exclude", OPT_EXCLUDE, N_("PATTERN"), 0,
+       N_("With --recursive, skip files and directories matching PATTERN. May be given several times"),
+       GROUP_ID+1 },
+     { "jobs", 'j', N_("NUMBER"), 0,
+       N_("Run at most NUMBER preprocessors in parallel when reading a compilation database (default: number of processors). If given, applies to lists of files as well"),
+       GROUP_ID+1 },
+     { "cache-dir", OPT_CACHE_DIR, N_("DIR"), 0,
+       N_("Cache preprocessor output in directory DIR"), GROUP_ID+1 },
+     { "cache-size", OPT_CACHE_SIZE, N_("SIZE"), 0,
+       N_("Limit the size of the preprocessor cache to SIZE bytes. The suffixes K, M and G are allowed (default: 100M)"),
+       GROUP_ID+1 },
+     { "cache-stats", OPT_CACHE_STATS, NULL, 0,
+       N_("Print preprocessor cache statistics"), GROUP_ID+1 },
+     { "db", OPT_DB, N_("DIR"), 0,
+       N_("Keep the facts extracted from each source file in the database DIR and reparse only files that changed"),
+       GROUP_ID+1 },
+     { "emit-facts", OPT_EMIT_FACTS, NULL, 0,
+       N_("Write the facts extracted from the input files to the output file, instead of producing a graph"),
+       GROUP_ID+1 },
+     { "merge", OPT_MERGE, NULL, 0,
+       N_("Input files are fact files created by --emit-facts"),
+       GROUP_ID+1 },
+#undef GROUP_ID
+#define GROUP_ID 20          
+     { NULL, 0, NULL, 0,
+       N_("Output control:"), GROUP_ID },
+     { "number", 'n', NULL, 0,
+       N_("* Print line numbers"), GROUP_ID+1 },
+     { "no-number", OPT_NO_NUMBER, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "print-level", 'l', NULL, 0,
+       N_("* Print nesting level along with the call tree"), GROUP_ID+1 },
+     { "no-print-level", OPT_NO_PRINT_LEVEL, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "level-indent", OPT_LEVEL_INDENT, "ELEMENT", 0,
+       N_("Control graph appearance"), GROUP_ID+1 },
+     { "tree", 'T', NULL, 0,
+       N_("* Draw ASCII art tree"), GROUP_ID+1 },
+     { "no-tree", OPT_NO_TREE, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "brief", 'b', NULL, 0,
+       N_("* Brief output"), GROUP_ID+1 },
+     { "no-brief", OPT_NO_BRIEF, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "emacs", OPT_EMACS, NULL, 0,
+       N_("* Additionally format output for use with GNU Emacs"), GROUP_ID+1 },
+     { "no-emacs", OPT_NO_EMACS, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "omit-arguments", OPT_OMIT_ARGUMENTS, NULL, 0,
+       N_("* Do not print argument lists in function declarations"), GROUP_ID+1 },
+     { "no-ignore-arguments", OPT_NO_OMIT_ARGUMENTS, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "omit-symbol-names", OPT_OMIT_SYMBOL_NAMES, NULL, 0,
+       N_("* Do not print symbol names in declaration strings"), GROUP_ID+1 },
+     { "no-omit-symbol-names", OPT_NO_OMIT_SYMBOL_NAMES, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "serve", OPT_SERVE, N_("SOCKET"), 0,
+       N_("Instead of producing the output, answer requests for it on the Unix socket SOCKET"),
+       GROUP_ID+1 },
+     { "watch", OPT_WATCH, NULL, 0,
+       N_("Watch input files and produce the output anew each time they change"),
+       GROUP_ID+1 },
+#undef GROUP_ID
+#define GROUP_ID 30                 
+     { NULL, 0, NULL, 0,
+       N_("Informational options:"), GROUP_ID },
+     { "verbose", 'v', NULL, 0,
+       N_("* Verbose error diagnostics"), GROUP_ID+1 },
+     { "no-verbose", OPT_NO_VERBOSE, NULL, OPTION_HIDDEN,
+       "", GROUP_ID+1 },
+     { "debug", OPT_DEBUG, "NUMBER", OPTION_ARG_OPTIONAL,
+       N_("Set debugging level"), GROUP_ID+1 },
+     { "stats", OPT_STATS, N_("FORMAT"), OPTION_ARG_OPTIONAL,
+       N_("Print the time spent in each processing phase and operation counts to stderr. FORMAT is `text' (default) or `json'"),
+       GROUP_ID+1 },
+#undef GROUP_ID     
+     { 0, }
+};
+
+/* Structure representing various arguments of command line options */
+struct option_type {
+    char *str;           /* optarg value */
+    int min_match;       /* minimal number of characters to match */
+    int type;            /* data associated with the arg */
+};
+
+int debug;              /* debug level */
+char *outname = "-";    /* default output file name */
+int print_option = 0;   /* what to print. */
+int verbose;            /* be verbose on output */
+int use_indentation;    /* Rely on indentation,
+			 * i.e. suppose the function body
+                         * is necessarily surrounded by the curly braces
+			 * in the first column
+                         */
+int record_defines;     /* Record macro definitions */
+int strict_ansi;        /* Assume sources to be written in ANSI C */
+int print_line_numbers; /* Print line numbers */
+int print_levels;       /* Print level number near every branch */
+int print_as_tree;      /* Print as tree */
+int brief_listing;      /* Produce short listing */
+int reverse_tree;       /* Generate reverse tree */
+int max_depth;          /* The depth at which the flowgraph is cut off */
+int emacs_option;       /* Format and check for use with Emacs cflow-mode */ 
+int omit_arguments_option;    /* Omit arguments from function declaration string */
+int omit_symbol_names_option; /* Omit symbol name from symbol declaration string */
+
+#define SM_FUNCTIONS   0x0001
+#define SM_DATA        0x0002
+#define SM_STATIC      0x0004
+#define SM_UNDERSCORE  0x0008
+#define SM_TYPEDEF     0x0010
+#define SM_UNDEFINED   0x0020
+
+#define CHAR_TO_SM(c) ((c)=='x' ? SM_DATA : \
+                        (c)=='_' ? SM_UNDERSCORE : \
+                         (c)=='s' ? SM_STATIC : \
+                          (c)=='t' ? SM_TYPEDEF : \
+                           (c)=='u' ? SM_UNDEFINED : 0)
+#define SYMBOL_INCLUDE(c) (symbol_map |= CHAR_TO_SM(c))
+#define SYMBOL_EXCLUDE(c) (symbol_map &= ~CHAR_TO_SM(c))
+/* A bitmap of symbols included in the graph. */
+int symbol_map = SM_FUNCTIONS|SM_STATIC|SM_UNDEFINED;
+
+char *level_indent[] = { NULL, NULL };
+char *level_end[] = { "", "" };
+char *level_begin = "";
+
+int preprocess_option = 0; /* Do they want to preprocess sources? */
+int split_units_option = 0; /* How compilation unit boundaries are marked
+			       in input streams */
+struct linked_list *skim_list; /* Prefixes of header files to skim */
+int cache_headers_option;   /* Reuse the results of parsing header regions */
+struct linked_list *recurse_list; /* Directories to search for sources */
+struct linked_list *match_list;   /* Patterns of source file names */
+struct linked_list *exclude_list; /* Patterns of names to skip */
+int max_jobs = 0;           /* Maximum number of preprocessors to run in
+			       parallel (0 means number of processors) */
+char *cache_dir;            /* Preprocessor cache directory */
+size_t cache_max_size = 100*1024*1024; /* Maximum size of the cache */
+int cache_stats_option;     /* Print cache statistics */
+char *db_dir;               /* Fact database directory */
+int emit_facts_option;      /* Write facts instead of the graph */
+int merge_option;           /* Input files contain facts */
+char *serve_socket;         /* Socket to serve requests on */
+int watch_option;           /* Watch input files for changes */
+struct linked_list *reachable_from; /* Functions to print the functions
+				       reachable from */
+struct linked_list *reaches;        /* Functions to print the functions
+				       reaching them */
+struct linked_list *path_list;      /* FROM:TO pairs to print the call
+				       paths for */
+int all_paths_option;               /* Print all shortest paths */
+struct linked_list *avoid_list;     /* Functions left out of queries */
+int levels_option;                  /* Print recursion groups and levels */
+int dominators_option;              /* Print the dominator tree */
+int stats_option;                   /* Print timing and counters */
+int stream_option;                  /* Produce output after each unit */
+
+char *start_name = "main"; /* Name of start symbol */
+
+struct linked_list *arglist;        /* List of command line arguments */
+
+/* Given the option_type array and (possibly abbreviated) option argument
+ * find the type corresponding to that argument.
+ * Return 0 if the argument does not match any one of OPTYPE entries
+ */
+static int
+find_option_type(struct option_type *optype, const char *str, int len)
+{
+     if (len == 0)
+	  len = strlen(str);
+     for ( ; optype->str; optype++) {
+	  if (len >= optype->min_match &&
+	      memcmp(str, optype->str, len) == 0) {
+	       return optype->type;
+	  }
+     }
+     return 0;
+}
+
+/* Args for --symbol option */
+static struct option_type symbol_optype[] = {
+     { "keyword", 2, WORD },
+     { "kw", 2, WORD },
+     { "modifier", 1, MODIFIER },
+     { "identifier", 1, IDENTIFIER },
+     { "type", 1, TYPE },
+     { "wrapper", 1, PARM_WRAPPER },
+     { "qualifier", 1, QUALIFIER },
+     { 0 },
+};
+
+/* Parse the string STR and store the symbol in the temporary symbol table.
+ * STR is the string of form: NAME:TYPE
+ * NAME means symbol name, TYPE means symbol type (possibly abbreviated)
+ */
+static void
+symbol_override(const char *str)
+{
+     const char *ptr;
+     char *name;
+     Symbol *sp;
+     
+     ptr = strchr(str, ':');
+     if (!ptr)
+	  error(EX_USAGE, 0, _("%s: no symbol type supplied"), str);
+     else {
+	  name = strndup(str, ptr - str);
+	  if (ptr[1] == '=') {
+	       Symbol *alias = lookup(ptr+2);
+	       if (!alias) {
+		    alias = install(xstrdup(ptr+2), INSTALL_OVERWRITE);
+		    alias->type = SymToken;
+		    alias->token_type = 0;
+		    alias->source = NULL;
+		    alias->def_line = -1;
+		    alias->ref_line = NULL;
+	       }
+	       sp = install(name, INSTALL_OVERWRITE);
+	       sp->type = SymToken;
+	       sp->alias = alias;
+	       sp->flag = symbol_alias;
+	  } else {
+	       int type = find_option_type(symbol_optype, ptr+1, 0);
+	       if (type == 0)
+		    error(EX_USAGE, 0, _("unknown symbol type: %s"), ptr+1);
+	       sp = install(name, INSTALL_OVERWRITE);
+	       sp->type = SymToken;
+	       sp->token_type = type;
+	  }
+	  sp->source = NULL;
+	  sp->def_line = -1;
+	  sp->ref_line = NULL;
+     }
+}
+
+/* Args for --print option */
+static struct option_type print_optype[] = {
+     { "xref", 1, PRINT_XREF },
+     { "cross-ref", 1, PRINT_XREF },
+     { "tree", 1, PRINT_TREE },
+     { 0 },
+};
+
+/* Args for --split-units option */
+static struct option_type split_units_optype[] = {
+     { "markers", 1, SPLIT_UNITS_MARKERS|SPLIT_UNITS_PRAGMA },
+     { "pragma", 1, SPLIT_UNITS_PRAGMA },
+     { 0 },
+};
+
+/* Args for --stats option */
+static struct option_type stats_optype[] = {
+     { "text", 1, STATS_TEXT },
+     { "json", 1, STATS_JSON },
+     { 0 },
+};
+
+static void
+set_print_option(char *str)
+{
+     int opt;
+     
+     opt = find_option_type(print_optype, str, 0);
+     if (opt == 0) {
+	  error(EX_USAGE, 0, _("unknown print option: %s"), str);
+	  return;
+     }
+     print_option |= opt;
+}
+
+/* Convert first COUNT bytes of the string pointed to by STR_PTR
+ * to integer using BASE. Move STR_PTR to the point where the
+ * conversion stopped.
+ * Return the number obtained.
+ */
+static int
+number(const char **str_ptr, int base, int count)
+{
+     int  c, n;
+     unsigned i;
+     const char *str = *str_ptr;
+     
+     for (n = 0; *str && count; count--) {
+	  c = *str++;
+	  if (isdigit(c))
+	       i = c - '0';
+	  else
+	       i = toupper(c) - 'A' + 10;
+	  if (i > base) {
+	       break;
+	  }
+	  n = n * base + i;
+     }
+     *str_ptr = str - 1;
+     return n;
+}
+
+/* Processing for --level option
+ * The option syntax is
+ *    --level NUMBER
+ * or
+ *    --level KEYWORD=STR
+ * where
+ *    KEYWORD is one of "begin", "0", ", "1", "end0", "end1",
+ *    or an abbreviation thereof,
+ *    STR is the value to be assigned to the parameter.
+ *  
+ * STR can contain usual C escape sequences plus \e meaning '\033'.
+ * Apart from this any character followed by xN suffix (where N is
+ * a decimal number) is expanded to the sequence of N such characters.
+ * 'x' looses its special meaning at the start of the string.
+ */
+#define MAXLEVELINDENT 216
+#define LEVEL_BEGIN 1
+#define LEVEL_INDENT0 2
+#define LEVEL_INDENT1 3
+#define LEVEL_END0 4
+#define LEVEL_END1 5
+
+static struct option_type level_indent_optype[] = {
+     { "begin", 1, LEVEL_BEGIN },
+     { "start", 1, LEVEL_BEGIN },
+     { "0", 1, LEVEL_INDENT0 },
+     { "1", 1, LEVEL_INDENT1 },
+     { "end0", 4, LEVEL_END0 },
+     { "end1", 4, LEVEL_END1 },
+};
+
+static void
+parse_level_string(const char *str, char **return_ptr)
+{
+     static char text[MAXLEVELINDENT];
+     char *p;
+     int i, c, num;
+    
+     p = text;
+     memset(text, ' ', sizeof(text));
+     text[sizeof(text)-1] = 0;
+     
+     while (*str) {
+	  switch (*str) {
+	  case '\\':
+	       switch (*++str) {
+	       case 'a':
+		    *p++ = '\a';
+		    break;
+	       case 'b':
+		    *p++ = '\b';
+		    break;
+	       case 'e':
+		    *p++ = '\033';
+		    break;
+	       case 'f':
+		    *p++ = '\f';
+		    break;
+	       case 'n':
+		    *p++ = '\n';
+		    break;
+	       case 'r':
+		    *p++ = '\r';
+		    break;
+	       case 't':
+		    *p++ = '\t';
+		    break;
+	       case 'x':
+	       case 'X':
+		    ++str;
+		    *p++ = number(&str,16,2);
+		    break;
+	       case '0':
+		    ++str;
+		    *p++ = number(&str,8,3);
+		    break;
+	       default:
+		    *p++ = *str;
+	       }
+	       ++str;
+	       break;
+	  case 'x':
+	       if (p == text) {
+		    goto copy;
+	       }
+	       num = strtol(str+1, (char**)&str, 10);
+	       c = p[-1];
+	       for (i = 1; i < num; i++) {
+		    *p++ = c;
+		    if (*p == 0)
+			 error(EX_USAGE, 0,
+			       _("level indent string is too long"));
+	       }
+	       break;
+	  default:
+	  copy:
+	       *p++ = *str++;
+	       if (*p == 0)
+		    error(EX_USAGE, 0, _("level indent string is too long"));
+	  }
+     }
+     *p = 0;
+     *return_ptr = strdup(text);
+}
+
+static void
+set_level_indent(const char *str)
+{
+     long n;
+     const char *p;
+     char *q;
+     
+     n = strtol(str, &q, 0);
+     if (*q == 0 && n > 0) {
+	  char *s = xmalloc(n+1);
+	  memset(s, ' ', n-1);
+	  s[n-1] = 0;
+	  level_indent[0] = level_indent[1] = s;
+	  return;
+     }
+     
+     p = str;
+     while (*p != '=') {
+	  if (*p == 0)
+	       error(EX_USAGE, 0, _("level-indent syntax"));
+	  p++;
+     }
+     ++p;
+    
+     switch (find_option_type(level_indent_optype, str, p - str - 1)) {
+     case LEVEL_BEGIN:
+	  parse_level_string(p, &level_begin);
+	  break;
+     case LEVEL_INDENT0:
+	  parse_level_string(p, &level_indent[0]);
+	  break;
+     case LEVEL_INDENT1:
+	  parse_level_string(p, &level_indent[1]);
+	  break;
+     case LEVEL_END0:
+	  parse_level_string(p, &level_end[0]);
+	  break;
+     case LEVEL_END1:
+	  parse_level_string(p, &level_end[1]);
+	  break;
+     default:
+	  error(EX_USAGE, 0, _("unknown level indent option: %s"), str);
+     }
+}
+
+static void
+add_name(const char *name)
+{
+     linked_list_append(&arglist, (void*) name);
+}
+
+static void
+add_preproc_option(int key, const char *arg)
+{
+     char *opt = xmalloc(3 + strlen(arg));
+     sprintf(opt, "-%c%s", key, arg);
+     add_name(opt);
+     preprocess_option = 1;
+}
+
+/* Add the list of files NAME.  It is passed on as @NAME. */
+static void
+add_list(const char *name)
+{
+     char *s = xmalloc(strlen(name) + 2);
+     s[0] = '@';
+     strcpy(s + 1, name);
+     add_name(s);
+}
+
+/* Convert the size specification ARG (a number optionally followed by
+   K, M or G) to bytes */
+static size_t
+parse_size(const char *arg)
+{
+     char *p;
+     unsigned long n;
+
+     errno = 0;
+     n = strtoul(arg, &p, 10);
+     if (errno || p == arg)
+	  error(EX_USAGE, 0, _("invalid size: %s"), arg);
+     switch (*p) {
+     case 'g':
+     case 'G':
+	  if (n > SIZE_MAX / 1024)
+	       error(EX_USAGE, 0, _("size too large: %s"), arg);
+	  n *= 1024;
+	  /* FALLTHRU */
+     case 'm':
+     case 'M':
+	  if (n > SIZE_MAX / 1024)
+	       error(EX_USAGE, 0, _("size too large: %s"), arg);
+	  n *= 1024;
+	  /* FALLTHRU */
+     case 'k':
+     case 'K':
+	  if (n > SIZE_MAX / 1024)
+	       error(EX_USAGE, 0, _("size too large: %s"), arg);
+	  n *= 1024;
+	  p++;
+     }
+     if (*p)
+	  error(EX_USAGE, 0, _("invalid size: %s"), arg);
+     return n;
+}
+
+/* Set while parsing a --serve request */
+static int serving;
+
+/* Options that only select what to output, and are therefore allowed
+   in --serve requests */
+static int serve_options[] = {
+     'd', 'i', 'f', 'r', OPT_NO_REVERSE, 'x', 'P', 'm',
+     OPT_DOMINATORS, OPT_REACHABLE_FROM, OPT_REACHES, OPT_LEVELS,
+     OPT_PATH, OPT_ALL_PATHS, OPT_AVOID,
+     'n', OPT_NO_NUMBER, 'l', OPT_NO_PRINT_LEVEL, OPT_LEVEL_INDENT,
+     'T', OPT_NO_TREE, 'b', OPT_NO_BRIEF, OPT_EMACS, OPT_NO_EMACS,
+     OPT_OMIT_ARGUMENTS, OPT_NO_OMIT_ARGUMENTS,
+     OPT_OMIT_SYMBOL_NAMES, OPT_NO_OMIT_SYMBOL_NAMES,
+     0
+};
+
+static int
+serve_option_allowed(int key)
+{
+     int i;
+
+     for (i = 0; serve_options[i]; i++)
+	  if (serve_options[i] == key)
+	       return 1;
+     return 0;
+}
+
+/* Return the long name of the option KEY */
+static const char *
+option_name(int key)
+{
+     struct argp_option *opt;
+
+     for (opt = options; opt->name || opt->doc; opt++)
+	  if (opt->key == key && opt->name)
+	       return opt->name;
+     return "?";
+}
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+     int num;
+
+     if (serving && key > 0 && key <= OPT_NO_STREAM
+	 && !serve_option_allowed(key))
+	  error(EX_USAGE, 0, _("--%s cannot be used in a request"),
+		option_name(key));
+     
+     switch (key) {
+     case 'a':
+	  strict_ansi = 1;
+	  break;
+     case OPT_NO_ANSI:
+	  strict_ansi = 0;
+	  break;
+     case OPT_DEBUG:
+	  debug = arg ? atoi(arg) : 1;
+	  break;
+     case OPT_STATS:
+	  if (!arg)
+	       stats_option = STATS_TEXT;
+	  else if ((stats_option = find_option_type(stats_optype, arg, 0)) == 0)
+	       error(EX_USAGE, 0, _("unknown statistics format: %s"), arg);
+	  break;
+     case 'P':
+	  set_print_option(arg);
+	  break;
+     case 'S':
+	  use_indentation = 1;
+	  break;
+     case OPT_NO_USE_INDENTATION:
+	  use_indentation = 0;
+	  break;
+     case 'T':
+	  print_as_tree = 1;
+	  set_level_indent("0=  "); /* two spaces */
+	  set_level_indent("1=| ");
+	  set_level_indent("end0=+-");
+	  set_level_indent("end1=\\\\-");
+	  break;
+     case OPT_NO_TREE:
+	  print_as_tree = 0;
+	  level_indent[0] = level_indent[1] = NULL;
+	  level_end[0] = level_end[1] = NULL;
+	  break;
+     case 'b':
+	  brief_listing = 1;
+	  break;
+     case OPT_NO_BRIEF:
+	  brief_listing = 0;
+	  break;
+     case 'd':
+	  max_depth = atoi(arg);
+	  if (max_depth < 0)
+	       max_depth = 0;
+	  break;
+     case OPT_DEFINES: /* FIXME: Not used. */
+	  record_defines = 1;
+	  break;
+     case OPT_EMACS:
+	  emacs_option = 1;
+	  break;
+     case OPT_NO_EMACS:
+	  emacs_option = 0;
+	  break;
+     case 'f':
+	  if (select_output_driver(arg))
+	       error(EX_USAGE, 0, _("%s: No such output driver"), optarg);
+	  output_init();
+	  break;
+     case OPT_LEVEL_INDENT:
+	  set_level_indent(arg);
+	  break;
+     case 'i':
+	  num = 1;
+	  for (; *arg; arg++) 
+	       switch (*arg) {
+	       case '-':
+	       case '^':
+		    num = 0;
+		    break;
+	       case '+':
+		    num = 1;
+		    break;
+	       case 'x':
+	       case '_':
+	       case 's':
+	       case 't':
+	       case 'u':
+		    if (num)
+			 SYMBOL_INCLUDE(*arg);
+		    else
+			 SYMBOL_EXCLUDE(*arg);
+		    break;
+	       default:
+		    error(EX_USAGE, 0, _("Unknown symbol class: %c"), *arg);
+	       }
+	  break;
+     case OPT_OMIT_ARGUMENTS:
+	  omit_arguments_option = 1;
+	  break;
+     case OPT_NO_OMIT_ARGUMENTS:
+	  omit_arguments_option = 0;
+	  break;
+     case OPT_OMIT_SYMBOL_NAMES:
+	  omit_symbol_names_option = 1;
+	  break;
+     case OPT_NO_OMIT_SYMBOL_NAMES:
+	  omit_symbol_names_option = 0;
+	  break;
+     case 'l':
+	  print_levels = 1;
+	  break;
+     case OPT_NO_PRINT_LEVEL:
+	  print_levels = 0;
+	  break;
+     case 'm':
+	  start_name = strdup(arg);
+	  break;
+     case 'n':
+	  print_line_numbers = 1;
+	  break;
+     case OPT_NO_NUMBER:
+	  print_line_numbers = 0;
+	  break;
+     case 'o':
+	  outname = strdup(arg);
+	  break;
+     case 'p':
+	  num = atoi(arg);
+	  if (num > 0)
+	       token_stack_length = num;
+	  break;
+     case 'r':
+	  reverse_tree = 1;
+	  break;
+     case OPT_NO_REVERSE:
+	  reverse_tree = 0;
+	  break;
+     case 's':
+	  symbol_override(arg);
+	  break;
+     case 'v':
+	  verbose = 1;
+	  break;
+     case OPT_NO_VERBOSE:
+	  verbose = 0;
+	  break;
+     case 'x':
+	  print_option = PRINT_XREF;
+	  SYMBOL_EXCLUDE('s'); /* Exclude static symbols by default */
+	  break;
+     case OPT_PREPROCESS:
+	  preprocess_option = 1;
+	  set_preprocessor(arg ? arg : CFLOW_PREPROC);
+	  break;
+     case OPT_NO_PREPROCESS:
+	  preprocess_option = 0;
+	  break;
+     case OPT_SPLIT_UNITS:
+	  if (!arg)
+	       split_units_option = SPLIT_UNITS_MARKERS|SPLIT_UNITS_PRAGMA;
+	  else if ((split_units_option =
+		    find_option_type(split_units_optype, arg, 0)) == 0)
+	       error(EX_USAGE, 0, _("unknown unit boundary kind: %s"), arg);
+	  break;
+     case OPT_NO_SPLIT_UNITS:
+	  split_units_option = 0;
+	  break;
+     case OPT_SKIM_HEADERS:
+	  linked_list_append(&skim_list, arg ? arg : "/usr/include");
+	  break;
+     case OPT_NO_SKIM_HEADERS:
+	  linked_list_destroy(&skim_list);
+	  break;
+     case OPT_CACHE_HEADERS:
+	  cache_headers_option = 1;
+	  break;
+     case OPT_NO_CACHE_HEADERS:
+	  cache_headers_option = 0;
+	  break;
+     case OPT_COMPILE_COMMANDS:
+	  ccdb_load(arg);
+	  break;
+     case OPT_FILES_FROM:
+	  add_list(arg);
+	  break;
+     case 'R':
+	  linked_list_append(&recurse_list, arg);
+	  break;
+     case OPT_MATCH:
+	  linked_list_append(&match_list, arg);
+	  break;
+     case OPT_EXCLUDE:
+	  linked_list_append(&exclude_list, arg);
+	  break;
+     case 'j':
+	  num = atoi(arg);
+	  if (num <= 0)
+	       error(EX_USAGE, 0, _("invalid number of jobs: %s"), arg);
+	  max_jobs = num;
+	  break;
+     case OPT_CACHE_DIR:
+	  cache_dir = arg;
+	  break;
+     case OPT_CACHE_SIZE:
+	  cache_max_size = parse_size(arg);
+	  break;
+     case OPT_CACHE_STATS:
+	  cache_stats_option = 1;
+	  break;
+     case OPT_DB:
+	  db_dir = arg;
+	  break;
+     case OPT_EMIT_FACTS:
+	  emit_facts_option = 1;
+	  break;
+     case OPT_MERGE:
+	  merge_option = 1;
+	  break;
+     case OPT_SERVE:
+	  serve_socket = arg;
+	  break;
+     case OPT_WATCH:
+#ifdef HAVE_SYS_INOTIFY_H
+	  watch_option = 1;
+#else
+	  error(EX_USAGE, 0, _("--watch is not supported on this system"));
+#endif
+	  break;
+     case OPT_REACHABLE_FROM:
+	  linked_list_append(&reachable_from, arg);
+	  break;
+     case OPT_REACHES:
+	  linked_list_append(&reaches, arg);
+	  break;
+     case OPT_PATH:
+	  linked_list_append(&path_list, arg);
+	  break;
+     case OPT_ALL_PATHS:
+	  all_paths_option = 1;
+	  break;
+     case OPT_AVOID:
+	  linked_list_append(&avoid_list, arg);
+	  break;
+     case OPT_LEVELS:
+	  levels_option = 1;
+	  break;
+     case OPT_DOMINATORS:
+	  dominators_option = 1;
+	  break;
+     case OPT_STREAM:
+	  stream_option = 1;
+	  break;
+     case OPT_NO_STREAM:
+	  stream_option = 0;
+	  break;
+     case ARGP_KEY_END:
+	  if (stream_option
+	      && (db_dir || emit_facts_option || merge_option || serve_socket
+		  || watch_option))
+	       error(EX_USAGE, 0,
+		     _("--stream cannot be used with --db, --emit-facts, --merge, --serve or --watch"));
+	  break;
+     case ARGP_KEY_ARG:
+	  add_name(arg);
+	  break;
+     case 'I':
+     case 'D':
+     case 'U':
+	  add_preproc_option(key, arg);
+	  break;
+     default:
+	  return ARGP_ERR_UNKNOWN;
+     }
+     return 0;
+}
+
+static struct argp argp = {
+     options,
+     parse_opt,
+     N_("[FILE]..."),
+     doc,
+     NULL,
+     NULL,
+     NULL
+};
+
+int
+globals_only()
+{
+     return !(symbol_map & SM_STATIC);
+}
+
+int
+include_symbol(Symbol *sym)
+{
+     int type = 0;
+     
+     if (!sym)
+	  return 0;
+     
+     if (sym->type == SymIdentifier) {
+	  if (sym->name[0] == '_' && !(symbol_map & SM_UNDERSCORE))
+	       return 0;
+
+	  if (sym->storage == StaticStorage)
+	       type |= SM_STATIC;
+	  if (sym->arity == -1 && sym->storage != AutoStorage)
+	       type |= SM_DATA;
+	  else if (sym->arity >= 0)
+	       type |= SM_FUNCTIONS;
+
+	  if (!sym->source)
+	       type |= SM_UNDEFINED;
+	  
+     } else if (sym->type == SymToken) {
+	  if (sym->token_type == TYPE && sym->source)
+	       type |= SM_TYPEDEF;
+	  else
+	       return 0;
+     }
+     return (symbol_map & type) == type;
+}
+
+void
+xalloc_die(void)
+{
+     error(EX_FATAL, ENOMEM, _("Exiting"));
+}
+
+static void
+init_level_indent()
+{
+     if (level_indent[0] == NULL) 
+	  level_indent[0] = "    "; /* 4 spaces */
+     if (level_indent[1] == NULL)
+	  level_indent[1] = level_indent[0];
+     if (level_end[0] == NULL)
+	  level_end[0] = "";
+     if (level_end[1] == NULL)
+	  level_end[1] = "";
+}
+
+void
+init()
+{
+     init_level_indent();
+     init_lex(debug > 2);
+     init_parse();
+}
+
+/* Answer a request of the query server.  ARGV contains output options,
+   optionally followed by the names of symbols to restrict the output
+   to.  This is called in a child process whose standard output and
+   error go to the client (see serve.c). */
+void
+serve_request(int argc, char **argv)
+{
+     struct linked_list_entry *p;
+
+     arglist = NULL;
+     serving = 1;
+     if (argp_parse(&argp, argc, argv, ARGP_IN_ORDER, NULL, NULL))
+	  exit(EX_USAGE);
+     for (p = linked_list_head(arglist); p; p = p->next) {
+	  char *s = (char*)p->data;
+	  if (s[0] != '-')
+	       linked_list_append(&output_symbols, s);
+     }
+     outname = "-";
+     init_level_indent();
+     output();
+}
+
+/* Parse the command line options in ARGV.  Store the index of the first
+   unprocessed argument in *INDEX.  Return 0 on success. */
+int
+parse_options(int argc, char **argv, int *index)
+{
+     return argp_parse(&argp, argc, argv, ARGP_IN_ORDER, index, NULL);
+}
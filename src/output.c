@@ -27,6 +27,8 @@ int level_mark_incr = 128; /* level_mark is expanded by this number of bytes */
 
 int out_line = 1; /* Current output line number */
 FILE *outfile;    /* Output file */
+struct linked_list *output_symbols; /* If not NULL, names of the symbols
+				       to restrict the output to */
 
 static void
 set_level_mark(int lev, int mark)
@@ -114,6 +116,7 @@ newline()
 					 NULL,
 				         output_driver[driver_index].handler_data);
      out_line++;
+     STATS_COUNT(STATS_LINE);
 }
 
 static void
@@ -179,10 +182,24 @@ compare(const void *ap, const void *bp)
      return strcmp((*a)->name, (*b)->name);
 }
 
+/* Return true if SYMP is to be output */
+static int
+is_selected(Symbol *symp)
+{
+     struct linked_list_entry *p;
+
+     if (!output_symbols)
+	  return 1;
+     for (p = linked_list_head(output_symbols); p; p = p->next)
+	  if (strcmp(symp->name, (char*)p->data) == 0)
+	       return 1;
+     return 0;
+}
+
 static int
 is_var(Symbol *symp)
 {
-     if (include_symbol(symp)) {
+     if (include_symbol(symp) && is_selected(symp)) {
 	  if (symp->type == SymIdentifier)
 	       return symp->storage == ExternStorage ||
 	 	      symp->storage == StaticStorage;
@@ -218,6 +235,7 @@ print_refs(char *name, struct linked_list *reflist)
 		  name,
 		  refptr->source,
 		  refptr->line);
+	  STATS_COUNT(STATS_LINE);
      }
 }
 
@@ -229,7 +247,8 @@ print_function(Symbol *symp)
 		  symp->name,
 		  symp->source,
 		  symp->def_line,
-		  symp->decl);
+		  symbol_decl(symp));
+	  STATS_COUNT(STATS_LINE);
      }
      print_refs(symp->name, symp->ref_line);
 }
@@ -237,11 +256,13 @@ print_function(Symbol *symp)
 static void
 print_type(Symbol *symp)
 {
-     if (symp->source)
+     if (symp->source) {
 	  fprintf(outfile, "%s t %s:%d\n",
 		  symp->name,
 		  symp->source,
 		  symp->def_line);
+	  STATS_COUNT(STATS_LINE);
+     }
 }
 
 void
@@ -250,10 +271,12 @@ xref_output()
      Symbol **symbols, *symp;
      size_t i, num;
 
+     stats_phase(STATS_COLLECT);
      num = collect_symbols(&symbols, is_var, 0);
      qsort(symbols, num, sizeof(*symbols), compare);
 
      /* produce xref output */
+     stats_phase(STATS_OUTPUT);
      for (i = 0; i < num; i++) {
 	  symp = symbols[i];
 	  switch (symp->type) {
@@ -344,6 +367,41 @@ inverted_tree(int lev, int last, Symbol *sym)
      clear_active(sym);
 }
 
+/* Produce the dominator tree output
+ */
+static void
+dominator_output()
+{
+     struct output_symbol *tree;
+     size_t i, num;
+
+     num = dominator_tree(&tree);
+     begin();
+     for (i = 0; i < num; i++) {
+	  if (tree[i].level)
+	       set_level_mark(tree[i].level, !tree[i].last);
+	  print_symbol(1, tree[i].level, tree[i].last, tree[i].sym);
+	  newline();
+     }
+     if (num)
+	  separator();
+     end();
+     free(tree);
+}
+
+/* Output the tree rooted at SYM, followed by a separator */
+static void
+root_tree(Symbol *sym)
+{
+     PROBE2(output__begin, sym->name, out_line);
+     if (reverse_tree)
+	  inverted_tree(0, 0, sym);
+     else
+	  direct_tree(0, 0, sym);
+     separator();
+     PROBE2(output__end, sym->name, out_line);
+}
+
 static void
 tree_output()
 {
@@ -351,7 +409,16 @@ tree_output()
      size_t i, num;
      cflow_depmap_t depmap;
 
+     /* The dominator tree marks the recursive functions itself, without
+	computing the transitive closure */
+     if (dominators_option) {
+	  stats_phase(STATS_OUTPUT);
+	  dominator_output();
+	  return;
+     }
+
      /* Collect functions and assign them ordinal numbers */
+     stats_phase(STATS_RECURSION);
      num = collect_functions(&symbols);
      for (i = 0; i < num; i++)
 	  symbols[i]->ord = i;
@@ -365,8 +432,12 @@ tree_output()
 	       for (p = linked_list_head(symbols[i]->callee); p;
 		    p = p->next) {
 		    Symbol *s = (Symbol*) p->data;
-		    if (symbol_is_function(s))
-			 depmap_set(depmap, i, ((Symbol*)p->data)->ord);
+		    /* Unit-local functions (e.g. the ones defined in
+		       headers) are not collected once their unit is
+		       finished, and their ordinal numbers are stale */
+		    if (symbol_is_function(s)
+			&& s->ord < num && symbols[s->ord] == s)
+			 depmap_set(depmap, i, s->ord);
 	       }
 	  }
      }
@@ -381,17 +452,20 @@ tree_output()
      free(symbols);
 
      /* Collect and sort all symbols */
+     stats_phase(STATS_COLLECT);
      num = collect_symbols(&symbols, is_var, 0);
      qsort(symbols, num, sizeof(*symbols), compare);
 
+     if (reverse_tree)
+	  build_caller_lists();
+     
      /* Produce output */
+     stats_phase(STATS_OUTPUT);
      begin();
 
-     if (reverse_tree) {
-	  for (i = 0; i < num; i++) {
-	       inverted_tree(0, 0, symbols[i]);
-	       separator();
-	  }
+     if (reverse_tree || output_symbols) {
+	  for (i = 0; i < num; i++)
+	       root_tree(symbols[i]);
      } else {
 	  main_sym = lookup(start_name);
     if(!main_sym){
@@ -402,15 +476,13 @@ tree_output()
         }
       }
     }
-	  if (main_sym) {
-	       direct_tree(0, 0, main_sym);
-	       separator();
-	  } else {
+	  if (main_sym)
+	       root_tree(main_sym);
+	  else {
 	       for (i = 0; i < num; i++) {
 		    if (symbols[i]->callee == NULL)
 			 continue;
-		    direct_tree(0, 0, symbols[i]);
-		    separator();
+		    root_tree(symbols[i]);
 	       }
 	  }
      }
@@ -420,23 +492,68 @@ tree_output()
      free(symbols);
 }
 
+/* Write the output to the stream FP */
 void
-output()
+output_stream(FILE *fp)
 {
-     if (strcmp(outname, "-") == 0) {
-	  outfile = stdout;
-     } else {
-	  outfile = fopen(outname, "w");
-	  if (!outfile)
-	       error(EX_FATAL, errno, _("cannot open file `%s'"), outname);
-     }
-
+     stats_phase(STATS_OUTPUT);
+     outfile = fp;
+     out_line = 1;
      set_level_mark(0, 0);
+     if (query_requested()) {
+	  query_output();
+	  return;
+     }
      if (print_option & PRINT_XREF) {
 	  xref_output();
      }
      if (print_option & PRINT_TREE) {
 	  tree_output();
      }
-     fclose(outfile);
+}
+
+static FILE *output_fp;   /* Output file, if open */
+
+/* Open the output file, unless it is already open */
+static FILE *
+output_open()
+{
+     if (!output_fp) {
+	  if (strcmp(outname, "-") == 0) {
+	       output_fp = stdout;
+	  } else {
+	       output_fp = fopen(outname, "w");
+	       if (!output_fp)
+		    error(EX_FATAL, errno, _("cannot open file `%s'"),
+			  outname);
+	  }
+     }
+     return output_fp;
+}
+
+/* Close the output file */
+void
+output_close()
+{
+     if (output_fp) {
+	  fclose(output_fp);
+	  output_fp = NULL;
+     }
+}
+
+void
+output()
+{
+     output_stream(output_open());
+     output_close();
+}
+
+/* Write the output for the compilation unit just parsed and forget its
+   symbols (--stream) */
+void
+output_unit()
+{
+     output_stream(output_open());
+     fflush(output_fp);
+     clear_symbols();
 }
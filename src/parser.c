@@ -17,6 +17,8 @@
 #include <cflow.h>
 #include <parser.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <hash.h>
 
 typedef struct {
      char *name;
@@ -37,6 +39,10 @@ void initializer_list();
 void func_body();
 void declare(Ident*, int maybe_knr);
 void declare_type(Ident*);
+void declare_auto(char *name);
+Symbol *define_symbol(char *name, enum storage storage, int parmcnt, int line);
+void define_type(char *name, int line);
+void set_caller(char *name);
 int dcl(Ident*);
 int parmdcl(Ident*);
 int dirdcl(Ident*);
@@ -52,11 +58,16 @@ Symbol *caller;             /* Current caller */
 struct obstack text_stk;    /* Obstack for composing declaration line */
 
 int parm_level;             /* Parameter declaration nesting level */
+static int record_refs;     /* Record each reference to a symbol.  The
+			       references are printed in cross-reference
+			       listing only, tree output needs just to
+			       know whether a symbol was referenced. */
 
 typedef struct {
      int type;
      char *token;
      int line;
+     int flags;    /* TOKEN_* flags */
 } TOKSTK;
 
 typedef int Stackpos[1];
@@ -223,6 +234,7 @@ mark(Stackpos pos)
 void
 restore(Stackpos pos)
 {
+     STATS_COUNT(STATS_RESTORE);
      curs = pos[0];
      if (curs) {
 	  tok = token_stack[curs-1];
@@ -233,6 +245,7 @@ restore(Stackpos pos)
 void
 tokdel(int beg, int end)
 {
+     STATS_COUNT(STATS_TOKDEL);
      if (end >= beg) {
 	  if (end < tos)
 	       memmove(token_stack + beg, token_stack + end + 1,
@@ -244,6 +257,7 @@ tokdel(int beg, int end)
 void
 tokins(int pos, int type, int line, char *token)
 {
+     STATS_COUNT(STATS_TOKINS);
      if (++tos == token_stack_length) {
 	  token_stack_length += token_stack_increase;
 	  token_stack = xrealloc(token_stack,
@@ -254,6 +268,7 @@ tokins(int pos, int type, int line, char *token)
      token_stack[pos].type = type;
      token_stack[pos].token = token;
      token_stack[pos].line = line;
+     token_stack[pos].flags = 0;
      debugtoken(&token_stack[pos], "insert at %d", pos);
 }
 
@@ -263,6 +278,7 @@ tokpush(int type, int line, char *token)
      token_stack[tos].type = type;
      token_stack[tos].token = token;
      token_stack[tos].line = line;
+     token_stack[tos].flags = 0;
      if (++tos == token_stack_length) {
 	  token_stack_length += token_stack_increase;
 	  token_stack = xrealloc(token_stack,
@@ -297,6 +313,7 @@ nexttoken()
      if (curs == tos) {
 	  type = get_token();
 	  tokpush(type, line_num, yylval.str);
+	  token_stack[tos-1].flags = token_flags;
 	  yylval.str = NULL;
      }
      tok = token_stack[curs];
@@ -327,6 +344,8 @@ init_parse()
      obstack_init(&text_stk);
      token_stack = xmalloc(token_stack_length*sizeof(*token_stack));
      clearstack();
+     /* The query server learns the output mode from each request */
+     record_refs = (print_option & PRINT_XREF) || serve_socket;
 }
 
 void
@@ -406,20 +425,43 @@ undo_save_stack()
      save_end = -1;
 }
 
-char *
-finish_save_stack(char *name)
+/* Declaration tokens saved for deferred rendering.  Most declarations
+   are never printed (e.g. because of -i filtering), so the declaration
+   string is composed only when it is first requested by symbol_decl(). */
+struct saved_decl {
+     int count;        /* Number of tokens */
+     TOKSTK tokens[1]; /* Tokens */
+};
+
+static struct saved_decl *
+finish_save_stack()
+{
+     struct saved_decl *sd;
+     int count = save_end > 0 ? save_end : 0;
+
+     sd = obstack_alloc(&text_stk,
+			sizeof(*sd) + count * sizeof(sd->tokens[0]));
+     sd->count = count;
+     memcpy(sd->tokens, token_stack, count * sizeof(token_stack[0]));
+     return sd;
+}
+
+static char *
+render_decl(struct saved_decl *sd, char *name)
 {
      int i;
      int level = 0;
      int found_ident = !omit_symbol_names_option;
 
      need_space = 0;
-     for (i = 0; i < save_end ; i++) {
-	  switch (token_stack[i].type) {
+     for (i = 0; i < sd->count; i++) {
+	  TOKSTK *tp = sd->tokens + i;
+	  
+	  switch (tp->type) {
 	  case '(':
 	       if (omit_arguments_option) {
 		    if (level == 0) {
-			 save_token(token_stack+i);
+			 save_token(tp);
 		    }
 		    level++;
 	       }
@@ -429,19 +471,147 @@ finish_save_stack(char *name)
 		    level--;
 	       break;
 	  case IDENTIFIER:
-	       if (!found_ident && strcmp (name, token_stack[i].token) == 0) {
+	       if (!found_ident && strcmp (name, tp->token) == 0) {
 		    need_space = 1;
 		    found_ident = 1;
 		    continue;
 	       }
 	  }
 	  if (level == 0)
-	       save_token(token_stack+i);
+	       save_token(tp);
      }
      obstack_1grow(&text_stk, 0);
      return obstack_finish(&text_stk);
 }
 
+/* Record the definition of IDENT with the declaration tokens SD as a
+   fact.  Each token that can appear in the declaration string is
+   represented by its type, the length of its text and the text itself,
+   separated by single spaces. */
+static void
+fact_define(Ident *ident, struct saved_decl *sd)
+{
+     int i;
+     char *str;
+
+     for (i = 0; i < sd->count; i++) {
+	  TOKSTK *tp = sd->tokens + i;
+	  char *text = tp->token ? tp->token : "";
+	  char buf[64];
+
+	  switch (tp->type) {
+	  case IDENTIFIER:
+	  case TYPE:
+	  case STRUCT:
+	  case PARM_WRAPPER:
+	  case WORD:
+	  case QUALIFIER:
+	  case MODIFIER:
+	  case OP:
+	  case ',':
+	  case '(':
+	  case ')':
+	  case '[':
+	  case ']':
+	       if (strchr(text, '\n'))
+		    continue;
+	       snprintf(buf, sizeof buf, " %d %lu ", tp->type,
+			(unsigned long) strlen(text));
+	       obstack_grow(&text_stk, buf, strlen(buf));
+	       obstack_grow(&text_stk, text, strlen(text));
+	  }
+     }
+     obstack_1grow(&text_stk, 0);
+     str = obstack_finish(&text_stk);
+     fact('d', "%s %d %d %d %d%s", ident->name, ident->storage,
+	  ident->parmcnt, ident->line, level, str);
+     obstack_free(&text_stk, str);
+}
+
+static Hash_table *string_table;
+
+static size_t
+string_hasher(void const *data, size_t n_buckets)
+{
+     return hash_string(data, n_buckets);
+}
+
+static bool
+string_compare(void const *data1, void const *data2)
+{
+     return strcmp(data1, data2) == 0;
+}
+
+/* Return a permanent copy of the string S.  Equal strings share the
+   same copy. */
+static char *
+intern_string(char *s)
+{
+     char *p;
+
+     if (!(string_table
+	   || (string_table = hash_initialize(0, 0, string_hasher,
+					      string_compare, 0))))
+	  xalloc_die();
+     p = hash_lookup(string_table, s);
+     if (!p) {
+	  p = xstrdup(s);
+	  if (!hash_insert(string_table, p))
+	       xalloc_die();
+     }
+     return p;
+}
+
+/* Return S, or its permanent copy if INTERN is set */
+static char *
+fact_string(char *s, int intern)
+{
+     return intern ? intern_string(s) : s;
+}
+
+/* Restore the declaration tokens from their representation in the
+   fact (see fact_define).  ARG is modified in place.  If INTERN is
+   set, the tokens do not refer to ARG. */
+static struct saved_decl *
+replay_decl(char *arg, int intern)
+{
+     struct saved_decl *sd;
+     TOKSTK t;
+     int count = 0;
+
+     obstack_blank(&text_stk, offsetof(struct saved_decl, tokens));
+     while (*arg) {
+	  size_t len;
+
+	  t.type = strtol(arg, &arg, 10);
+	  len = strtoul(arg, &arg, 10);
+	  if (*arg++ != ' ' || strlen(arg) < len)
+	       break;
+	  t.token = arg;
+	  t.line = 0;
+	  arg += len;
+	  if (*arg)
+	       *arg++ = 0;
+	  t.token = fact_string(t.token, intern);
+	  obstack_grow(&text_stk, &t, sizeof(t));
+	  count++;
+     }
+     sd = obstack_finish(&text_stk);
+     sd->count = count;
+     return sd;
+}
+
+/* Return the declaration string of SYM, composing it if necessary */
+char *
+symbol_decl(Symbol *sym)
+{
+     if (!sym->decl && sym->saved_decl) {
+	  sym->decl = render_decl(sym->saved_decl, sym->name);
+	  sym->saved_decl = NULL;
+     }
+     return sym->decl;
+}
+
 void
 skip_to(int c)
 {
@@ -478,6 +648,88 @@ skip_balanced(int open_tok, int close_tok, int level)
      return -1;
 }
 
+/* Skip the top-level declaration or function definition beginning
+   with the current token, which comes from a header being skimmed (see
+   --skim-headers).  Return 0 if it has been skipped.  Typedefs are not
+   skipped: instead, the token stack is restored and 1 is returned, so
+   that the declared type names are registered. */
+static int
+skim_declaration()
+{
+     Stackpos sp;
+     int prev = 0;
+     int body;
+
+     mark(sp);
+     for (;;) {
+	  switch (tok.type) {
+	  case 0:
+	  case ';':
+	       return 0;
+	  case TYPEDEF:
+	       restore(sp);
+	       return 1;
+	  case LBRACE0:
+	  case '{':
+	       /* A brace block following a parameter list is a function
+		  body and ends the definition */
+	       body = prev == ')' || prev == 0;
+	       if (skip_balanced('{', '}', 1) == -1)
+		    return 0;
+	       if (body) {
+		    putback();
+		    return 0;
+	       }
+	       prev = '}';
+	       continue;
+	  }
+	  prev = tok.type;
+	  nexttoken();
+     }
+}
+
+static int recording;          /* A header region is being recorded */
+static unsigned recording_ends; /* Value of regions_ended when the
+				   recording began */
+
+/* Handle the header regions for --cache-headers.  Called before each
+   top-level declaration.  Finish recording the region that ends with
+   it, if any, and if the current token begins a new one, look it up in
+   the cache.  Return 1 if the region has been replayed from there, and
+   its tokens dropped. */
+static int
+header_region()
+{
+     cache_hash_t hash;
+     char *name;
+
+     if (recording) {
+	  if (tok.flags & TOKEN_REGION_END) {
+	       hdrcache_record_end(1);
+	       recording = 0;
+	  } else if (regions_ended != recording_ends) {
+	       /* The region ended in the middle of a declaration */
+	       hdrcache_record_end(0);
+	       recording = 0;
+	  }
+     }
+     if (!(tok.flags & TOKEN_REGION_BEGIN) || tos != 1 || curs != 1
+	 || fact_output)
+	  return 0;
+     name = filename;
+     if (region_lookahead(&hash))
+	  return 0;
+     if (hdrcache_replay(name, hash) == 0) {
+	  region_drop();
+	  clearstack();
+	  return 1;
+     }
+     hdrcache_record_begin(name, hash);
+     recording = 1;
+     recording_ends = regions_ended;
+     return 0;
+}
+
 int
 yyparse()
 {
@@ -487,6 +739,13 @@ yyparse()
      caller = NULL;
      clearstack();
      while (nexttoken()) {
+	  PROBE2(declaration__begin, filename, tok.line);
+	  if (cache_headers_option && header_region())
+	       continue;
+	  if ((tok.flags & TOKEN_SKIM) && skim_declaration() == 0) {
+	       cleanup_stack();
+	       continue;
+	  }
 	  identifier.storage = ExternStorage;
 	  switch (tok.type) {
 	  case 0:
@@ -509,6 +768,11 @@ yyparse()
 	       break;
 	  }
 	  cleanup_stack();
+	  PROBE2(declaration__end, filename, line_num);
+     }
+     if (recording) {
+	  hdrcache_record_end(0);
+	  recording = 0;
      }
      return 0;
 }
@@ -558,6 +822,7 @@ parse_declaration(Ident *ident, int parm)
 	  parse_function_declaration(ident, parm);
      else
 	  parse_variable_declaration(ident, parm);
+     FACT(('p', "%d", parm_level));
      delete_parms(parm_level);
 }
 
@@ -653,9 +918,7 @@ parse_function_declaration(Ident *ident, int parm)
      case LBRACE0:
      case LBRACE:
 	  if (ident->name) {
-	       caller = lookup(ident->name);
-	       if (caller && caller->storage == AutoStorage)
-		    caller = NULL;
+	       set_caller(ident->name);
 	       func_body();
 	  }
 	  break;
@@ -1019,7 +1282,9 @@ func_body()
 {
      Ident ident;
      
+     PROBE1(function__entry, caller ? caller->name : "");
      level++;
+     FACT(('m', "%d", level));
      move_parms(level);
      while (level) {
 	  cleanup_stack();
@@ -1051,6 +1316,7 @@ func_body()
 		    if (verbose && level != 1)
 			 file_error(_("forced function body close"), NULL);
 		    for ( ; level; level--) {
+			 FACT(('x', "%d", level));
 			 delete_autos(level);
 		    }
 		    break;
@@ -1058,6 +1324,7 @@ func_body()
 	       /* else: */
 	       /* FALLTHRU */
 	  case '}':
+	       FACT(('x', "%d", level));
 	       delete_autos(level);
 	       level--;
 	       break;
@@ -1065,11 +1332,13 @@ func_body()
 	       if (verbose)
 		    file_error(_("unexpected end of file in function body"),
 			       NULL);
-	       caller = NULL;
+	       PROBE1(function__return, caller ? caller->name : "");
+	       set_caller(NULL);
 	       return;
 	  }
      }
-     caller = NULL;
+     PROBE1(function__return, caller ? caller->name : "");
+     set_caller(NULL);
 }
 
 int
@@ -1130,15 +1399,10 @@ declare(Ident *ident, int maybe_knr)
 {
      Symbol *sp;
      
+     PROBE2(declare, ident->name, ident->line);
      if (ident->storage == AutoStorage) {
 	  undo_save_stack();
-	  sp = install_ident(ident->name, ident->storage);
-	  if (parm_level) {
-	       sp->level = parm_level;
-	       sp->flag = symbol_parm;
-	  } else
-	       sp->level = level;
-	  sp->arity = -1;
+	  declare_auto(ident->name);
 	  return;
      } 
 
@@ -1152,62 +1416,141 @@ declare(Ident *ident, int maybe_knr)
 	  return;
      }
      
-     sp = get_symbol(ident->name);
+     sp = define_symbol(ident->name, ident->storage, ident->parmcnt,
+			ident->line);
+     sp->saved_decl = finish_save_stack();
+     if (fact_output)
+	  fact_define(ident, sp->saved_decl);
+     /* In verbose mode, compose the declaration right away, so that
+	eventual diagnostics refer to the right location */
+     if (verbose)
+	  symbol_decl(sp);
+     if (debug)
+	  fprintf(stderr, _("%s:%d: %s/%d defined to %s\n"),
+		 filename,
+		 line_num,
+		 ident->name, ident->parmcnt,
+		 symbol_decl(sp));
+}
+
+/* Declare an automatic variable or parameter NAME at the current
+   nesting level */
+void
+declare_auto(char *name)
+{
+     Symbol *sp;
+
+     FACT(('a', "%s %d %d", name, level, parm_level));
+     sp = install_ident(name, AutoStorage);
+     if (parm_level) {
+	  sp->level = parm_level;
+	  sp->flag = symbol_parm;
+     } else
+	  sp->level = level;
+     sp->arity = -1;
+}
+
+/* Define the symbol NAME with the given STORAGE and number of
+   parameters PARMCNT (-1 for variables) at the line LINE of the current
+   source file.  The declaration string is left unset. */
+Symbol *
+define_symbol(char *name, enum storage storage, int parmcnt, int line)
+{
+     Symbol *sp;
+
+     sp = get_symbol(name);
      if (sp->source) {
-	  if (ident->storage == StaticStorage
+	  if (storage == StaticStorage
 	      && (sp->storage != StaticStorage || level > 0)) {
-	       sp = install_ident(ident->name, ident->storage);
+	       sp = install_ident(name, storage);
 	  } else {
 	       if (sp->arity >= 0)
-		    error_at_line(0, 0, filename, ident->line, 
+		    error_at_line(0, 0, filename, line, 
 				  _("%s/%d redefined"),
-				  ident->name, sp->arity);
+				  name, sp->arity);
 	       else
-		    error_at_line(0, 0, filename, ident->line, 
+		    error_at_line(0, 0, filename, line, 
 				  _("%s redefined"),
-				  ident->name);
+				  name);
 	       error_at_line(0, 0, sp->source, sp->def_line,
 			     _("this is the place of previous definition"));
 	  }
      }
 
      sp->type = SymIdentifier;
-     sp->arity = ident->parmcnt;
+     sp->arity = parmcnt;
      ident_change_storage(sp, 
-			  (ident->storage == ExplicitExternStorage) ?
-			  ExternStorage : ident->storage);
-     sp->decl = finish_save_stack(ident->name);
+			  (storage == ExplicitExternStorage) ?
+			  ExternStorage : storage);
+     sp->decl = NULL;
+     sp->saved_decl = NULL;
      sp->source = filename;
-     sp->def_line = ident->line;
+     sp->def_line = line;
      sp->level = level;
-     if (debug)
-	  fprintf(stderr, _("%s:%d: %s/%d defined to %s\n"),
-		 filename,
-		 line_num,
-		 ident->name, ident->parmcnt,
-		 sp->decl);
+     if (level > 0)
+	  block_symbol(sp);
+     return sp;
 }
 
 void
 declare_type(Ident *ident)
+{
+     undo_save_stack();
+     define_type(ident->name, ident->line);
+}
+
+/* Define NAME as a type name at the line LINE of the current source */
+void
+define_type(char *name, int line)
 {
      Symbol *sp;
      
-     undo_save_stack();
-     sp = lookup(ident->name);
+     FACT(('t', "%s %d", name, line));
+     sp = lookup(name);
      for ( ; sp; sp = sp->next)
 	  if (sp->type == SymToken && sp->token_type == TYPE)
 	       break;
      if (!sp)
-	  sp = install(ident->name, INSTALL_UNIT_LOCAL);
+	  sp = install(name, INSTALL_UNIT_LOCAL);
      sp->type = SymToken;
      sp->token_type = TYPE;
      sp->source = filename;
-     sp->def_line = ident->line;
+     sp->def_line = line;
      sp->ref_line = NULL;
      if (debug)
 	  fprintf(stderr, _("%s:%d: type %s\n"), filename, line_num,
-		  ident->name);
+		  name);
+}
+
+static unsigned long edge_stamp; /* Stamp of the current caller */
+
+/* Set the current caller to the function NAME, whose body begins.  NAME
+   is NULL at the end of the function body. */
+void
+set_caller(char *name)
+{
+     if (name) {
+	  FACT(('b', "%s", name));
+	  caller = lookup(name);
+	  if (caller && caller->storage == AutoStorage)
+	       caller = NULL;
+	  if (caller) {
+	       struct linked_list_entry *p;
+
+	       /* Give the caller a new stamp and mark the callees it
+		  already has (if its body was seen before), so that
+		  add_callee can tell duplicate edges without searching
+		  the list. */
+	       edge_stamp++;
+	       for (p = linked_list_head(caller->callee); p; p = p->next) {
+		    STATS_COUNT(STATS_CALLEE_CHECK);
+		    ((Symbol*)p->data)->edge_stamp = edge_stamp;
+	       }
+	  }
+     } else {
+	  FACT(('e', ""));
+	  caller = NULL;
+     }
 }
 
 Symbol *
@@ -1235,6 +1578,10 @@ add_reference(char *name, int line)
      if (sp->storage == AutoStorage
 	 || (sp->storage == StaticStorage && globals_only()))
 	  return NULL;
+     STATS_COUNT(STATS_REF);
+     sp->referenced = 1;
+     if (!record_refs)
+	  return sp;
      refptr = xmalloc(sizeof(*refptr));
      refptr->source = filename;
      refptr->line = line;
@@ -1244,36 +1591,233 @@ add_reference(char *name, int line)
      return sp;
 }
 
+/* Caller lists are needed for reverse trees only, so they are not
+   maintained while parsing.  Instead, build_caller_lists() derives them
+   from the callee lists.  To reproduce the order in which callers would
+   have been added, the callee entries are logged as a sequence of
+   segments, each one being a run of entries appended to the same caller.
+   This log is kept only if reverse_tree is set, or if requests for
+   reverse trees may come later (--serve). */
+struct caller_segment {
+     Symbol *caller;                  /* The caller */
+     struct linked_list_entry *start; /* First callee entry in the run */
+     size_t count;                    /* Number of entries in the run */
+};
+
+static struct linked_list *segment_list;
+static struct caller_segment *cur_segment;
+
+/* Record the edge CALLER -> SP */
+static void
+add_callee(Symbol *sp)
+{
+     STATS_COUNT(STATS_CALLEE_CHECK);
+     if (sp->edge_stamp == edge_stamp)
+	  return;
+     sp->edge_stamp = edge_stamp;
+     STATS_COUNT(STATS_EDGE);
+     linked_list_append(&caller->callee, sp);
+     if (reverse_tree || serve_socket) {
+	  if (!cur_segment || cur_segment->caller != caller) {
+	       cur_segment = xmalloc(sizeof(*cur_segment));
+	       cur_segment->caller = caller;
+	       cur_segment->start = caller->callee->tail;
+	       cur_segment->count = 0;
+	       linked_list_append(&segment_list, cur_segment);
+	  }
+	  cur_segment->count++;
+     }
+}
+
+/* Build the caller list of each symbol in a single pass over the
+   callee lists. */
+void
+build_caller_lists()
+{
+     struct linked_list_entry *p, *q;
+
+     for (p = linked_list_head(segment_list); p; p = p->next) {
+	  struct caller_segment *seg = p->data;
+	  size_t i;
+	  
+	  for (q = seg->start, i = 0; i < seg->count; q = q->next, i++)
+	       linked_list_append(&((Symbol*)q->data)->caller, seg->caller);
+     }
+     if (segment_list) {
+	  segment_list->free_data = free;
+	  linked_list_destroy(&segment_list);
+     }
+     cur_segment = NULL;
+}
 
 void
 call(char *name, int line)
 {
      Symbol *sp;
 
+     FACT(('c', "%s %d", name, line));
+     PROBE2(call, name, line);
      sp = add_reference(name, line);
      if (!sp)
 	  return;
      if (sp->arity < 0)
 	  sp->arity = 0;
-     if (caller) {
-	  if (!data_in_list(caller, sp->caller))
-	       linked_list_append(&sp->caller, caller);
-	  if (!data_in_list(sp, caller->callee))
-	       linked_list_append(&caller->callee, sp);
-     }
+     if (caller)
+	  add_callee(sp);
 }
 
 void
 reference(char *name, int line)
 {
-     Symbol *sp = add_reference(name, line);
+     Symbol *sp;
+
+     FACT(('r', "%s %d", name, line));
+     sp = add_reference(name, line);
      if (!sp)
 	  return;
-     if (caller) {
-	  if (!data_in_list(caller, sp->caller))
-	       linked_list_append(&sp->caller, caller);
-	  if (!data_in_list(sp, caller->callee))
-	       linked_list_append(&caller->callee, sp);
+     if (caller)
+	  add_callee(sp);
+}
+
+
+/* Return the next space-delimited word from *PP */
+static char *
+fact_word(char **pp)
+{
+     char *p = *pp, *start;
+
+     while (*p == ' ')
+	  p++;
+     start = p;
+     while (*p && *p != ' ')
+	  p++;
+     if (*p)
+	  *p++ = 0;
+     *pp = p;
+     return start;
+}
+
+#define fact_num(pp) atoi(fact_word(pp))
+
+/* Replay the facts in TEXT, up to its end or to a line beginning
+   with `S '.  If INTERN is set, the strings stored in the symbol table
+   are copied, so that TEXT may be discarded afterwards.  Return the
+   position where it stopped, or NULL if TEXT is malformed. */
+static char *
+replay_fact_list(char *text, int intern)
+{
+     char *p, *next;
+
+     for (p = text; *p && !(p[0] == 'S' && p[1] == ' '); p = next) {
+	  int code = *p;
+	  char *arg, *id;
+
+	  next = strchr(p, '\n');
+	  if (!next)
+	       return NULL;
+	  *next++ = 0;
+	  arg = p[1] ? p + 2 : p + 1;
+	  switch (code) {
+	  case 'F':
+	       filename = fact_string(arg, intern);
+	       break;
+	  case 'U':
+	       canonical_filename = fact_string(arg, intern);
+	       break;
+	  case 'N':
+	       delete_statics();
+	       input_file_count++;
+	       break;
+	  case 'd': {
+	       Symbol *sp;
+	       enum storage storage;
+	       int parmcnt, line;
+
+	       id = fact_string(fact_word(&arg), intern);
+	       storage = fact_num(&arg);
+	       parmcnt = fact_num(&arg);
+	       line = fact_num(&arg);
+	       level = strtol(arg, &arg, 10);
+	       sp = define_symbol(id, storage, parmcnt, line);
+	       sp->saved_decl = replay_decl(arg, intern);
+	       break;
+	  }
+	  case 'a':
+	       id = fact_string(fact_word(&arg), intern);
+	       level = fact_num(&arg);
+	       parm_level = fact_num(&arg);
+	       declare_auto(id);
+	       break;
+	  case 't':
+	       id = fact_string(fact_word(&arg), intern);
+	       define_type(id, fact_num(&arg));
+	       break;
+	  case 'c':
+	       id = fact_string(fact_word(&arg), intern);
+	       call(id, fact_num(&arg));
+	       break;
+	  case 'r':
+	       id = fact_string(fact_word(&arg), intern);
+	       reference(id, fact_num(&arg));
+	       break;
+	  case 'b':
+	       set_caller(arg);
+	       break;
+	  case 'e':
+	       set_caller(NULL);
+	       break;
+	  case 'm':
+	       move_parms(fact_num(&arg));
+	       break;
+	  case 'p':
+	       delete_parms(fact_num(&arg));
+	       break;
+	  case 'x':
+	       delete_autos(fact_num(&arg));
+	       break;
+	  default:
+	       return NULL;
+	  }
      }
+     return p;
+}
+
+/* Replay the facts recorded while parsing the source file NAME (see
+   factdb.c).  TEXT is modified in place and must not be freed, since
+   the symbol table will refer to the strings in it.  Replaying stops
+   at the end of TEXT or at a line beginning with `S ', which starts
+   the facts of the next source in a fact file.  Return the position
+   where it stopped, or NULL if TEXT is malformed. */
+char *
+replay_facts(char *text, char *name)
+{
+     char *p;
+     
+     filename = canonical_filename = name;
+     input_file_count++;
+     level = parm_level = 0;
+     caller = NULL;
+     p = replay_fact_list(text, 0);
+     if (p)
+	  delete_statics();
+     return p;
 }
 
+/* Replay the facts recorded while parsing a header region beginning in
+   the file NAME (see hdrcache.c) as part of the current compilation
+   unit.  TEXT is modified in place, but may be discarded afterwards:
+   the strings the symbol table refers to are kept in a string table,
+   so that regions replayed many times do not take more memory each
+   time.  NAME must not be freed.  Return the position where replaying
+   stopped, or NULL if TEXT is malformed. */
+char *
+replay_region(char *text, char *name)
+{
+     char *p;
+
+     filename = name;
+     p = replay_fact_list(text, 1);
+     level = parm_level = 0;
+     caller = NULL;
+     return p;
+}
@@ -44,5 +44,16 @@ extern char *filename;
 extern char *canonical_filename;
 extern int line_num;
 
+/* Token flags */
+#define TOKEN_SKIM          0x01 /* Comes from a skimmed header */
+#define TOKEN_REGION_BEGIN  0x02 /* Begins a header region */
+#define TOKEN_REGION_END    0x04 /* Follows a header region */
+
+extern int token_flags;
+extern unsigned regions_ended;
+int region_lookahead(cache_hash_t *ph);
+void region_drop(void);
+char *replay_region(char *text, char *name);
+
 extern int yylex(void);
 
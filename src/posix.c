@@ -20,9 +20,11 @@
 static void
 print_symbol_type(FILE *outfile, Symbol *sym)
 {
-     if (sym->decl) 
+     char *decl = symbol_decl(sym);
+     
+     if (decl) 
 	  fprintf(outfile, "%s, <%s %d>",
-		  sym->decl,
+		  decl,
 		  sym->source,
 		  sym->def_line);
      else
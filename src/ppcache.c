@@ -0,0 +1,611 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Preprocessor output cache.
+
+   Each cache entry is a file named by the hash of the current working
+   directory, the preprocessor command line, the identity of the
+   preprocessor program and the contents of the source file.  The
+   entry begins with a manifest listing the headers named in line
+   markers of the preprocessor output, along with the size and hash of
+   each.  The preprocessed text follows.  An entry is used only if none
+   of its headers has changed since it was created.
+
+   When the cache grows beyond cache_max_size bytes, least recently
+   used entries are removed. */
+
+#include <cflow.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <utime.h>
+#include <xgetcwd.h>
+#include <hash.h>
+#include <stat-time.h>
+#include <timespec.h>
+
+#define CACHE_MAGIC "cflow-ppcache 1\n"
+#define CACHE_SUFFIX ".pp"
+
+#define FNV_PRIME  1099511628211ULL
+
+/* Statistics */
+static unsigned long cache_hits;
+static unsigned long cache_misses;
+static unsigned long long cache_bytes_read;
+static unsigned long long cache_bytes_stored;
+static unsigned long cache_evicted;
+
+static int cache_disabled;
+static struct obstack cache_stk;
+
+cache_hash_t
+cache_hash_buf(cache_hash_t h, const void *buf, size_t size)
+{
+     const unsigned char *p = buf;
+
+     while (size--) {
+	  h ^= *p++;
+	  h *= FNV_PRIME;
+     }
+     return h;
+}
+
+/* Compute the hash of the contents of file NAME and store it in *PH.
+   Return 0 on success, -1 if the file cannot be read. */
+int
+cache_hash_file(cache_hash_t h, const char *name, cache_hash_t *ph)
+{
+     FILE *fp;
+     char buf[8192];
+     size_t n;
+
+     fp = fopen(name, "r");
+     if (!fp)
+	  return -1;
+     while ((n = fread(buf, 1, sizeof buf, fp)) > 0)
+	  h = cache_hash_buf(h, buf, n);
+     if (ferror(fp)) {
+	  fclose(fp);
+	  return -1;
+     }
+     fclose(fp);
+     *ph = h;
+     return 0;
+}
+
+static int
+cache_init()
+{
+     static int initialized;
+     struct stat st;
+
+     if (initialized)
+	  return cache_disabled ? -1 : 0;
+     initialized = 1;
+     if (stat(cache_dir, &st) == 0) {
+	  if (!S_ISDIR(st.st_mode)) {
+	       errno = ENOTDIR;
+	       cache_disabled = 1;
+	  }
+     } else if (errno != ENOENT || mkdir(cache_dir, 0777))
+	  cache_disabled = 1;
+     if (cache_disabled) {
+	  error(0, errno, _("cannot use cache directory `%s'"), cache_dir);
+	  return -1;
+     }
+     obstack_init(&cache_stk);
+     return 0;
+}
+
+static char *
+cache_entry_name(cache_hash_t key, const char *suffix)
+{
+     char *s = xmalloc(strlen(cache_dir) + 1 + 16 + strlen(suffix) + 1);
+     sprintf(s, "%s/%016llx%s", cache_dir, key, suffix);
+     return s;
+}
+
+/* Dependency lists.
+
+   A dependency list records the files the cached data was obtained
+   from.  It begins with the number of files, followed by a line for
+   each file, containing its hash, size and name. */
+
+static size_t
+string_hasher(void const *data, size_t n_buckets)
+{
+     return hash_string(data, n_buckets);
+}
+
+static bool
+string_compare(void const *data1, void const *data2)
+{
+     return strcmp(data1, data2) == 0;
+}
+
+/* Create an empty table of dependencies */
+struct hash_table *
+cache_deps_create()
+{
+     Hash_table *tab;
+
+     tab = hash_initialize(0, 0, string_hasher, string_compare, free);
+     if (!tab)
+	  xalloc_die();
+     return tab;
+}
+
+/* Add file NAME to the table of dependencies TAB */
+void
+cache_deps_add(struct hash_table *tab, const char *name)
+{
+     if (hash_lookup(tab, name) == NULL) {
+	  char *s = xstrdup(name);
+	  if (!hash_insert(tab, s))
+	       xalloc_die();
+     }
+}
+
+/* Read the dependency list from FP and verify that none of the files
+   listed in it has changed.  Return 0 if so. */
+int
+cache_deps_check(FILE *fp)
+{
+     unsigned long count;
+     char *name = NULL;
+     size_t size = 0;
+     int rc = 0;
+
+     if (fscanf(fp, "%lu\n", &count) != 1)
+	  return -1;
+     while (rc == 0 && count--) {
+	  cache_hash_t hash, h;
+	  unsigned long long fsize;
+	  size_t i;
+	  int c;
+	  struct stat st;
+
+	  if (fscanf(fp, "%llx %llu ", &hash, &fsize) != 2)
+	       rc = -1;
+	  else {
+	       for (i = 0; (c = getc(fp)) != EOF && c != '\n'; i++) {
+		    if (i + 1 >= size)
+			 name = x2nrealloc(name, &size, 1);
+		    name[i] = c;
+	       }
+	       if (i + 1 >= size)
+		    name = x2nrealloc(name, &size, 1);
+	       name[i] = 0;
+	       rc = stat(name, &st) || st.st_size != fsize
+		    || cache_hash_file(CACHE_HASH_INIT, name, &h) || h != hash
+		    ? -1 : 0;
+	  }
+     }
+     free(name);
+     return rc;
+}
+
+static bool
+deps_write_entry(void *data, void *proc_data)
+{
+     char *name = data;
+     FILE *out = proc_data;
+     struct stat st;
+     cache_hash_t h;
+
+     if (strchr(name, '\n') || stat(name, &st)
+	 || cache_hash_file(CACHE_HASH_INIT, name, &h))
+	  return false;
+     fprintf(out, "%016llx %llu %s\n", h,
+	     (unsigned long long) st.st_size, name);
+     return true;
+}
+
+/* Write the dependency list TAB to OUT.  Return 0 on success. */
+int
+cache_deps_write(FILE *out, struct hash_table *tab)
+{
+     size_t n = hash_get_n_entries(tab);
+
+     fprintf(out, "%lu\n", (unsigned long) n);
+     return hash_do_for_each(tab, deps_write_entry, out) == n ? 0 : -1;
+}
+
+/* Read the manifest of the cache entry from FP and verify that all
+   headers listed in it are unchanged.  Return 0 if so. */
+static int
+manifest_check(FILE *fp)
+{
+     char buf[sizeof CACHE_MAGIC];
+
+     if (!fgets(buf, sizeof buf, fp) || strcmp(buf, CACHE_MAGIC))
+	  return -1;
+     return cache_deps_check(fp);
+}
+
+/* Write the manifest listing headers from TAB to OUT.  Return 0 on
+   success. */
+static int
+manifest_write(FILE *out, Hash_table *tab)
+{
+     fputs(CACHE_MAGIC, out);
+     return cache_deps_write(out, tab);
+}
+
+/* Headers named in line markers */
+
+/* Parse the line marker in the null-terminated string LINE.  If it names
+   a header file, store its name on cache_stk and return it. */
+static char *
+parse_marker(char *line, const char *source)
+{
+     char *p = line + 1;
+     char *name;
+
+     while (*p == ' ' || *p == '\t')
+	  p++;
+     if (strncmp(p, "line", 4) == 0)
+	  p += 4;
+     while (*p == ' ' || *p == '\t')
+	  p++;
+     if (!isdigit(*p))
+	  return NULL;
+     while (isdigit(*p))
+	  p++;
+     while (*p == ' ' || *p == '\t')
+	  p++;
+     if (*p++ != '"' || *p == '<')
+	  return NULL;
+     for (; *p && *p != '"'; p++) {
+	  if (*p == '\\' && p[1])
+	       p++;
+	  obstack_1grow(&cache_stk, *p);
+     }
+     obstack_1grow(&cache_stk, 0);
+     name = obstack_finish(&cache_stk);
+     if (*p != '"' || strcmp(name, source) == 0) {
+	  obstack_free(&cache_stk, name);
+	  return NULL;
+     }
+     return name;
+}
+
+/* Scan preprocessor output in FP and collect the names of headers from
+   the line markers.  Return the table of names. */
+static Hash_table *
+collect_headers(FILE *fp, const char *source)
+{
+     Hash_table *tab;
+     int c, bol = 1;
+
+     tab = cache_deps_create();
+     while ((c = getc(fp)) != EOF) {
+	  if (bol && c == '#') {
+	       char *line, *name;
+
+	       do
+		    obstack_1grow(&cache_stk, c);
+	       while ((c = getc(fp)) != EOF && c != '\n');
+	       obstack_1grow(&cache_stk, 0);
+	       line = obstack_finish(&cache_stk);
+	       name = parse_marker(line, source);
+	       if (name)
+		    cache_deps_add(tab, name);
+	       obstack_free(&cache_stk, line);
+	  }
+	  bol = c == '\n';
+     }
+     return tab;
+}
+
+/* Store the preprocessor output from FP as the cache entry KEY */
+static void
+cache_store(cache_hash_t key, FILE *fp, const char *source)
+{
+     Hash_table *tab;
+     char *tmpname;
+     int fd;
+     FILE *out;
+     char buf[8192];
+     size_t n;
+     int rc;
+
+     tab = collect_headers(fp, source);
+     rewind(fp);
+
+     tmpname = cache_entry_name(key, ".XXXXXX");
+     fd = mkstemp(tmpname);
+     if (fd == -1) {
+	  error(0, errno, _("cannot create cache file"));
+	  free(tmpname);
+	  hash_free(tab);
+	  return;
+     }
+     out = fdopen(fd, "w");
+     rc = manifest_write(out, tab);
+     hash_free(tab);
+     while (rc == 0 && (n = fread(buf, 1, sizeof buf, fp)) > 0) {
+	  fwrite(buf, 1, n, out);
+	  cache_bytes_stored += n;
+     }
+     if (ferror(fp) || ferror(out))
+	  rc = -1;
+     if (fclose(out))
+	  rc = -1;
+     if (rc == 0) {
+	  char *name = cache_entry_name(key, CACHE_SUFFIX);
+	  if (rename(tmpname, name))
+	       rc = -1;
+	  free(name);
+     }
+     if (rc)
+	  unlink(tmpname);
+     free(tmpname);
+     rewind(fp);
+}
+
+/* Find the program NAME in PATH, as the shell would, and fill ST with
+   its status.  Return its full name (allocated by xmalloc), or NULL if
+   it is not found. */
+static char *
+find_program(const char *name, struct stat *st)
+{
+     const char *path, *p;
+     char *full;
+
+     if (strchr(name, '/'))
+	  return stat(name, st) == 0 ? xstrdup(name) : NULL;
+     path = getenv("PATH");
+     if (!path)
+	  return NULL;
+     for (;;) {
+	  size_t len;
+
+	  p = strchr(path, ':');
+	  len = p ? p - path : strlen(path);
+	  full = xmalloc(len + strlen(name) + 3);
+	  if (len == 0)
+	       strcpy(full, ".");
+	  else {
+	       memcpy(full, path, len);
+	       full[len] = 0;
+	  }
+	  strcat(full, "/");
+	  strcat(full, name);
+	  if (access(full, X_OK) == 0 && stat(full, st) == 0
+	      && S_ISREG(st->st_mode))
+	       return full;
+	  free(full);
+	  if (!p)
+	       return NULL;
+	  path = p + 1;
+     }
+}
+
+/* Add to H the command line CMD and the identity of the program it runs
+   (its full name, device, inode, size and modification time), so that
+   entries created by another version of the preprocessor are not used
+   after it is upgraded. */
+cache_hash_t
+cache_hash_command(cache_hash_t h, const char *cmd)
+{
+     static char *prog;          /* Program name of the last command */
+     static cache_hash_t prog_hash;
+     size_t len = strcspn(cmd, " \t");
+
+     if (!prog || strlen(prog) != len || memcmp(prog, cmd, len)) {
+	  struct stat st;
+	  char *full;
+
+	  free(prog);
+	  prog = xmalloc(len + 1);
+	  memcpy(prog, cmd, len);
+	  prog[len] = 0;
+	  prog_hash = CACHE_HASH_INIT;
+	  full = find_program(prog, &st);
+	  if (full) {
+	       struct timespec mtime = get_stat_mtime(&st);
+
+	       prog_hash = cache_hash_buf(prog_hash, full, strlen(full) + 1);
+	       prog_hash = cache_hash_buf(prog_hash, &st.st_dev,
+					  sizeof st.st_dev);
+	       prog_hash = cache_hash_buf(prog_hash, &st.st_ino,
+					  sizeof st.st_ino);
+	       prog_hash = cache_hash_buf(prog_hash, &st.st_size,
+					  sizeof st.st_size);
+	       prog_hash = cache_hash_buf(prog_hash, &mtime, sizeof mtime);
+	       free(full);
+	  }
+     }
+     h = cache_hash_buf(h, cmd, strlen(cmd) + 1);
+     return cache_hash_buf(h, &prog_hash, sizeof prog_hash);
+}
+
+/* Compute the cache key for the source file NAME, to be preprocessed
+   by command CMD. */
+static int
+cache_key(const char *name, const char *cmd, cache_hash_t *pkey)
+{
+     char *cwd = xgetcwd();
+     cache_hash_t h;
+
+     if (!cwd)
+	  return -1;
+     h = cache_hash_buf(CACHE_HASH_INIT, CACHE_MAGIC, sizeof CACHE_MAGIC);
+     h = cache_hash_buf(h, cwd, strlen(cwd) + 1);
+     h = cache_hash_command(h, cmd);
+     free(cwd);
+     return cache_hash_file(h, name, pkey);
+}
+
+/* Return a stream with the preprocessed text of the source file NAME,
+   either from the cache, or by running the preprocessor.  The stream
+   must be closed with fclose. */
+FILE *
+ppcache_open(const char *name)
+{
+     cache_hash_t key;
+     char *cmd, *entry;
+     FILE *fp, *pp;
+     char buf[8192];
+     size_t n;
+     int status;
+
+     if (cache_init())
+	  return NULL;
+     cmd = pp_command(NULL, name);
+     status = cache_key(name, cmd, &key);
+     free(cmd);
+     if (status) {
+	  error(0, errno, _("cannot compute cache key for `%s'"), name);
+	  return NULL;
+     }
+
+     entry = cache_entry_name(key, CACHE_SUFFIX);
+     fp = fopen(entry, "r");
+     if (fp) {
+	  if (manifest_check(fp) == 0) {
+	       struct stat st;
+
+	       if (debug)
+		    fprintf(stderr, _("%s: using cached preprocessor output\n"),
+			    name);
+	       utime(entry, NULL);
+	       free(entry);
+	       if (fstat(fileno(fp), &st) == 0)
+		    cache_bytes_read += st.st_size - ftell(fp);
+	       cache_hits++;
+	       return fp;
+	  }
+	  fclose(fp);
+     }
+     free(entry);
+     cache_misses++;
+
+     pp = pp_open(name);
+     if (!pp)
+	  return NULL;
+     fp = tmpfile();
+     if (!fp) {
+	  error(0, errno, _("cannot create temporary file"));
+	  pclose(pp);
+	  return NULL;
+     }
+     while ((n = fread(buf, 1, sizeof buf, pp)) > 0)
+	  fwrite(buf, 1, n, fp);
+     status = pclose(pp);
+     rewind(fp);
+     if (status == 0 && !ferror(fp))
+	  cache_store(key, fp, name);
+     return fp;
+}
+
+
+/* Cache eviction */
+
+struct cache_file {
+     char *name;
+     off_t size;
+     struct timespec mtime;
+};
+
+static int
+cmp_mtime(const void *a, const void *b)
+{
+     const struct cache_file *fa = a, *fb = b;
+     return timespec_cmp(fa->mtime, fb->mtime);
+}
+
+/* Remove least recently used entries until the cache size does not
+   exceed cache_max_size.  Return the resulting cache size. */
+static unsigned long long
+cache_evict()
+{
+     DIR *dir;
+     struct dirent *ent;
+     struct cache_file *files = NULL;
+     size_t nfiles = 0, maxfiles = 0, i;
+     unsigned long long total = 0;
+     size_t slen = strlen(CACHE_SUFFIX);
+
+     dir = opendir(cache_dir);
+     if (!dir) {
+	  error(0, errno, _("cannot open directory `%s'"), cache_dir);
+	  return 0;
+     }
+     while ((ent = readdir(dir))) {
+	  size_t len = strlen(ent->d_name);
+	  struct stat st;
+	  char *name;
+
+	  if (len <= slen || strcmp(ent->d_name + len - slen, CACHE_SUFFIX))
+	       continue;
+	  name = xmalloc(strlen(cache_dir) + 1 + len + 1);
+	  sprintf(name, "%s/%s", cache_dir, ent->d_name);
+	  if (stat(name, &st)) {
+	       free(name);
+	       continue;
+	  }
+	  if (nfiles == maxfiles) {
+	       maxfiles += 64;
+	       files = xrealloc(files, maxfiles * sizeof(files[0]));
+	  }
+	  files[nfiles].name = name;
+	  files[nfiles].size = st.st_size;
+	  files[nfiles].mtime = get_stat_mtime(&st);
+	  nfiles++;
+	  total += st.st_size;
+     }
+     closedir(dir);
+
+     if (total > cache_max_size) {
+	  qsort(files, nfiles, sizeof(files[0]), cmp_mtime);
+	  for (i = 0; i < nfiles && total > cache_max_size; i++) {
+	       if (unlink(files[i].name) == 0) {
+		    total -= files[i].size;
+		    cache_evicted++;
+	       }
+	  }
+     }
+     for (i = 0; i < nfiles; i++)
+	  free(files[i].name);
+     free(files);
+     return total;
+}
+
+/* Finish using the cache: enforce its size limit and print statistics,
+   if requested. */
+void
+ppcache_finish()
+{
+     unsigned long long size = 0;
+
+     if (!cache_dir || cache_disabled)
+	  return;
+     if (cache_misses || cache_stats_option)
+	  size = cache_evict();
+     if (cache_stats_option) {
+	  fprintf(stderr, _("cache hits: %lu\n"), cache_hits);
+	  fprintf(stderr, _("cache misses: %lu\n"), cache_misses);
+	  fprintf(stderr, _("bytes read from cache: %llu\n"),
+		  cache_bytes_read);
+	  fprintf(stderr, _("bytes stored in cache: %llu\n"),
+		  cache_bytes_stored);
+	  fprintf(stderr, _("entries evicted: %lu\n"), cache_evicted);
+	  fprintf(stderr, _("cache size: %llu\n"), size);
+     }
+}
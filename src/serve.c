@@ -0,0 +1,146 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Query server (--serve).
+
+   Once the input files are parsed, cflow listens on a Unix socket
+   instead of producing the output.  The socket is accessible to the
+   owner only.  A client sends a single line containing output options
+   (those that affect parsing or name files are rejected) and,
+   optionally, names of the symbols to restrict the output to, e.g.:
+
+     -r -d 2 foo
+
+   The request is answered by a child process, which inherits the
+   symbol table from the server.  It parses the options as if they
+   were given on the command line after the server's ones, writes the
+   output (or diagnostics) to the connection and exits. */
+
+#include <cflow.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <wordsplit.h>
+
+static volatile sig_atomic_t stop;
+
+static void
+sig_stop(int sig)
+{
+     stop = 1;
+}
+
+/* Read the request from the connection FD and answer it */
+static void
+serve_connection(int fd)
+{
+     FILE *fp;
+     struct obstack stk;
+     struct wordsplit ws;
+     char *line, **argv;
+     int c;
+
+     fp = fdopen(fd, "r");
+     if (!fp)
+	  _exit(EX_FATAL);
+     obstack_init(&stk);
+     while ((c = getc(fp)) != EOF && c != '\n')
+	  obstack_1grow(&stk, c);
+     obstack_1grow(&stk, 0);
+     line = obstack_finish(&stk);
+
+     dup2(fd, 1);
+     dup2(fd, 2);
+     if (wordsplit(line, &ws, WRDSF_DEFFLAGS))
+	  error(EX_USAGE, 0, "%s", wordsplit_strerror(&ws));
+     argv = xcalloc(ws.ws_wordc + 2, sizeof(argv[0]));
+     argv[0] = "cflow";
+     memcpy(argv + 1, ws.ws_wordv, ws.ws_wordc * sizeof(argv[0]));
+     serve_request(ws.ws_wordc + 1, argv);
+     exit(EX_OK);
+}
+
+/* Listen on the Unix socket NAME and answer requests until terminated
+   by a signal */
+void
+serve(char *name)
+{
+     struct sockaddr_un addr;
+     struct sigaction act;
+     struct stat st;
+     mode_t mask;
+     int sock, fd;
+     pid_t pid;
+
+     if (strlen(name) >= sizeof(addr.sun_path))
+	  error(EX_FATAL, 0, _("%s: socket name too long"), name);
+     memset(&addr, 0, sizeof(addr));
+     addr.sun_family = AF_UNIX;
+     strcpy(addr.sun_path, name);
+
+     /* Remove the stale socket left by a previous server */
+     if (stat(name, &st) == 0 && S_ISSOCK(st.st_mode))
+	  unlink(name);
+
+     sock = socket(PF_UNIX, SOCK_STREAM, 0);
+     if (sock == -1)
+	  error(EX_FATAL, errno, _("cannot create socket"));
+     /* Only the owner may connect: requests are answered with the
+	contents of the parsed sources */
+     mask = umask(077);
+     if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)))
+	  error(EX_FATAL, errno, _("cannot bind to `%s'"), name);
+     umask(mask);
+     if (listen(sock, 8))
+	  error(EX_FATAL, errno, _("cannot listen on `%s'"), name);
+
+     /* Let accept be interrupted by termination signals, so that the
+	socket is removed on exit */
+     memset(&act, 0, sizeof(act));
+     act.sa_handler = sig_stop;
+     sigemptyset(&act.sa_mask);
+     sigaction(SIGINT, &act, NULL);
+     sigaction(SIGTERM, &act, NULL);
+     sigaction(SIGHUP, &act, NULL);
+     /* Children are not waited for */
+     signal(SIGCHLD, SIG_IGN);
+
+     fflush(stdout);
+     fflush(stderr);
+     while (!stop) {
+	  fd = accept(sock, NULL, NULL);
+	  if (fd == -1) {
+	       if (errno == EINTR || errno == ECONNABORTED)
+		    continue;
+	       error(EX_FATAL, errno, _("accept failed"));
+	  }
+	  pid = fork();
+	  if (pid == -1)
+	       error(0, errno, _("cannot fork"));
+	  else if (pid == 0) {
+	       close(sock);
+	       signal(SIGINT, SIG_DFL);
+	       signal(SIGTERM, SIG_DFL);
+	       signal(SIGHUP, SIG_DFL);
+	       signal(SIGCHLD, SIG_DFL);
+	       serve_connection(fd);
+	  }
+	  close(fd);
+     }
+     close(sock);
+     unlink(name);
+}
@@ -0,0 +1,210 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Phase timing and operation counters (--stats).
+
+   The time is charged to the current phase, which is changed by
+   stats_phase().  Scanning and waiting for the preprocessor are nested
+   in parsing and are entered once per token, so only the wall clock
+   time is measured for them: reading the CPU clock takes a system call,
+   which would slow the scanner down considerably.  Their CPU time is
+   included in that of parsing.
+
+   Counters are incremented unconditionally, as this is cheaper than
+   checking whether they are needed. */
+
+#include <cflow.h>
+#include <time.h>
+
+unsigned long long stats_counter[STATS_COUNTER_COUNT];
+
+struct phase_time {
+     double wall;  /* Wall clock time, in seconds */
+     double cpu;   /* CPU time, in seconds */
+};
+
+static struct phase_time phase_time[STATS_PHASE_COUNT];
+static int cur_phase = STATS_OPTIONS;
+static int outer_phase = STATS_OPTIONS; /* Last phase that is not nested */
+static struct phase_time last;  /* Clock readings at the last change */
+
+static char *phase_name[] = {
+     N_("options"),
+     N_("parse"),
+     N_("preprocess"),
+     N_("scan"),
+     N_("recursion"),
+     N_("collect"),
+     N_("output")
+};
+
+struct counter_def {
+     char *key;    /* JSON key */
+     char *text;   /* Label in text format */
+};
+
+static struct counter_def counter_def[] = {
+     { "tokens", N_("tokens scanned") },
+     { "backtracks", N_("backtracks") },
+     { "tokins", N_("token insertions") },
+     { "tokdel", N_("token deletions") },
+     { "lookups", N_("symbol lookups") },
+     { "probes", N_("hash probes") },
+     { "installed", N_("symbols installed") },
+     { "deleted", N_("symbols deleted") },
+     { "edges", N_("edges") },
+     { "refs", N_("references") },
+     { "lines", N_("lines emitted") },
+     { "callee_checks", N_("callee checks") },
+     { "block_exits", N_("block exits") },
+     { "block_scanned", N_("symbols scanned at block exits") },
+     { "header_hits", N_("header regions replayed") },
+     { "header_misses", N_("header regions parsed") }
+};
+
+static int
+is_nested(int phase)
+{
+     return phase == STATS_PREPROC || phase == STATS_SCAN;
+}
+
+static double
+wall_clock()
+{
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double
+cpu_clock()
+{
+     return (double) clock() / CLOCKS_PER_SEC;
+}
+
+/* Start the clock.  The time until the first call to stats_phase() is
+   charged to option parsing. */
+void
+stats_init()
+{
+     last.wall = wall_clock();
+     last.cpu = cpu_clock();
+}
+
+/* Charge the wall clock time elapsed since the last reading to the
+   current phase and, if it is nested, to the enclosing one as well. */
+static void
+charge_wall()
+{
+     double now = wall_clock();
+
+     phase_time[cur_phase].wall += now - last.wall;
+     if (cur_phase != outer_phase)
+	  phase_time[outer_phase].wall += now - last.wall;
+     last.wall = now;
+}
+
+/* Charge the CPU time elapsed since the last reading to the current
+   outer phase */
+static void
+charge_cpu()
+{
+     double now = cpu_clock();
+
+     phase_time[outer_phase].cpu += now - last.cpu;
+     last.cpu = now;
+}
+
+/* Make PHASE the current phase.  Return the previous one. */
+int
+stats_phase(int phase)
+{
+     int prev = cur_phase;
+
+     if (stats_option && phase != cur_phase) {
+	  charge_wall();
+	  if (!is_nested(phase) && phase != outer_phase) {
+	       charge_cpu();
+	       outer_phase = phase;
+	  }
+	  cur_phase = phase;
+     }
+     return prev;
+}
+
+static void
+report_text(size_t max_chain)
+{
+     int i;
+     struct phase_time total = { 0, 0 };
+
+     for (i = 0; i < STATS_PHASE_COUNT; i++) {
+	  if (is_nested(i)) {
+	       fprintf(stderr, _("time %s: %.6f wall\n"),
+		       gettext(phase_name[i]), phase_time[i].wall);
+	       continue;
+	  }
+	  fprintf(stderr, _("time %s: %.6f wall, %.6f cpu\n"),
+		  gettext(phase_name[i]),
+		  phase_time[i].wall, phase_time[i].cpu);
+	  total.wall += phase_time[i].wall;
+	  total.cpu += phase_time[i].cpu;
+     }
+     fprintf(stderr, _("time total: %.6f wall, %.6f cpu\n"),
+	     total.wall, total.cpu);
+     for (i = 0; i < STATS_COUNTER_COUNT; i++)
+	  fprintf(stderr, "%s: %llu\n", gettext(counter_def[i].text),
+		  stats_counter[i]);
+     fprintf(stderr, _("longest hash chain: %lu\n"), (unsigned long) max_chain);
+}
+
+static void
+report_json(size_t max_chain)
+{
+     int i;
+
+     fprintf(stderr, "{\"phases\":{");
+     for (i = 0; i < STATS_PHASE_COUNT; i++) {
+	  fprintf(stderr, "%s\"%s\":{\"wall\":%.6f",
+		  i ? "," : "", phase_name[i], phase_time[i].wall);
+	  if (!is_nested(i))
+	       fprintf(stderr, ",\"cpu\":%.6f", phase_time[i].cpu);
+	  fprintf(stderr, "}");
+     }
+     fprintf(stderr, "},\"counters\":{");
+     for (i = 0; i < STATS_COUNTER_COUNT; i++)
+	  fprintf(stderr, "\"%s\":%llu,", counter_def[i].key,
+		  stats_counter[i]);
+     fprintf(stderr, "\"max_chain\":%lu}}\n", (unsigned long) max_chain);
+}
+
+/* Print the statistics to stderr in the format requested by --stats */
+void
+stats_report()
+{
+     size_t max_chain;
+
+     if (!stats_option)
+	  return;
+     charge_wall();
+     charge_cpu();
+     max_chain = symbol_max_chain();
+     if (stats_option == STATS_JSON)
+	  report_json(max_chain);
+     else
+	  report_text(max_chain);
+}
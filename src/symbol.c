@@ -23,7 +23,13 @@ static Hash_table *symbol_table;
 static struct linked_list *static_symbol_list;
 static struct linked_list *auto_symbol_list;
 static struct linked_list *static_func_list;
+static struct linked_list *block_static_list; /* Symbols from
+						 static_symbol_list defined
+						 in the open blocks */
 
+/* Move SP to the list *PLIST.  SP->entry points to the entry of the
+   list it is in, so no search is needed to find out whether it is
+   already there. */
 static void
 append_symbol(struct linked_list **plist, Symbol *sp)
 {
@@ -31,10 +37,8 @@ append_symbol(struct linked_list **plist, Symbol *sp)
 	  linked_list_unlink(sp->entry->list, sp->entry);
 	  sp->entry = NULL;
      }
-     if (!data_in_list(sp, *plist)) {
-	  linked_list_append(plist, sp);
-	  sp->entry = (*plist)->tail;
-     }
+     linked_list_append(plist, sp);
+     sp->entry = (*plist)->tail;
 }
 
 struct table_entry {
@@ -57,6 +61,7 @@ hash_symbol_compare(void const *data1, void const *data2)
 {
      struct table_entry const *t1 = data1;
      struct table_entry const *t2 = data2;
+     STATS_COUNT(STATS_PROBE);
      return t1->sym && t2->sym && strcmp(t1->sym->name, t2->sym->name) == 0;
 }
 
@@ -66,6 +71,7 @@ lookup(const char *name)
      Symbol s, *sym;
      struct table_entry t, *tp;
      
+     STATS_COUNT(STATS_LOOKUP);
      if (!symbol_table)
 	  return NULL;
      s.name = (char*) name;
@@ -123,6 +129,7 @@ install(char *name, int flags)
 	  free(tp);
      }
      sym->owner = ret;
+     STATS_COUNT(STATS_INSTALL);
      return sym;
 }
 
@@ -159,8 +166,10 @@ install_ident(char *name, enum storage storage)
      sp->arity = -1;
      sp->storage = ExternStorage;
      sp->decl = NULL;
+     sp->saved_decl = NULL;
      sp->source = NULL;
      sp->def_line = -1;
+     sp->referenced = 0;
      sp->ref_line = NULL;
      sp->caller = sp->callee = NULL;
      sp->level = -1;
@@ -174,6 +183,15 @@ unlink_symbol(Symbol *sym)
 {
      Symbol *s, *prev = NULL;
      struct table_entry *tp = sym->owner;
+
+     sym->owner = NULL;
+     if (tp->sym == sym && !sym->next) {
+	  /* Remove the entry, which would otherwise stay in the table
+	     and lengthen the chain searched by each lookup of this name */
+	  hash_delete(symbol_table, tp);
+	  free(tp);
+	  return;
+     }
      for (s = tp->sym; s; ) {
 	  Symbol *next = s->next;
 	  if (s == sym) {
@@ -186,18 +204,18 @@ unlink_symbol(Symbol *sym)
 	       prev = s;
 	  s = next;
      }
-	       
-     sym->owner = NULL;
 }     
 
 /* Unlink and free the first symbol from the table entry */
 static void
 delete_symbol(Symbol *sym)
 {
+     STATS_COUNT(STATS_DELETE);
      unlink_symbol(sym);
      /* The symbol could have been referenced even if it is static
 	in -i^s mode. See tests/static.at for details. */
-     if (sym->ref_line == NULL && !(reverse_tree && sym->callee)) {
+     if (!sym->referenced
+	 && !((reverse_tree || serve_socket) && sym->callee)) {
 	  linked_list_destroy(&sym->ref_line);
 	  linked_list_destroy(&sym->caller);
 	  linked_list_destroy(&sym->callee);
@@ -234,6 +252,7 @@ static_free(void *data)
 void
 delete_statics()
 {
+     linked_list_destroy(&block_static_list);
      if (static_symbol_list) {
 	  static_symbol_list->free_data = static_free;
 	  linked_list_destroy(&static_symbol_list);
@@ -249,6 +268,7 @@ delete_level_autos(void *data, void *call_data)
 {
      int level = *(int*)call_data;
      Symbol *s = data;
+     STATS_COUNT(STATS_BLOCK_SCAN);
      if (s->level == level) {
 	  delete_symbol(s);
 	  return 1;
@@ -261,8 +281,10 @@ delete_level_statics(void *data, void *call_data)
 {
      int level = *(int*)call_data;
      Symbol *s = data;
+     STATS_COUNT(STATS_BLOCK_SCAN);
      if (s->level == level) {
-	  unlink_symbol(s);
+	  if (s->owner)
+	       unlink_symbol(s);
 	  return 1;
      }
      return 0;
@@ -271,8 +293,21 @@ delete_level_statics(void *data, void *call_data)
 void
 delete_autos(int level)
 {
+     STATS_COUNT(STATS_BLOCK_EXIT);
      linked_list_iterate(&auto_symbol_list, delete_level_autos, &level);
-     linked_list_iterate(&static_symbol_list, delete_level_statics, &level);
+     linked_list_iterate(&block_static_list, delete_level_statics, &level);
+}
+
+/* Note that the symbol SP has been defined in a block.  If it is a
+   static or unit-local one, it will be unlinked from the symbol table
+   at the exit from that block.  Only such symbols are examined by
+   delete_autos(), as scanning all static symbols of the source at
+   each block exit would take quadratic time. */
+void
+block_symbol(Symbol *sp)
+{
+     if (sp->entry && sp->entry->list == static_symbol_list)
+	  linked_list_append(&block_static_list, sp);
 }
 
 struct collect_data {
@@ -351,6 +386,40 @@ collect_functions(Symbol ***return_sym)
      return num;
 }
 
+static int
+is_identifier(Symbol *sym)
+{
+     return sym->type != SymToken;
+}
+
+/* Remove all identifiers from the symbol table and free them, along
+   with the static functions of the finished compilation units
+   (--stream).  Keywords, type names and aliases are kept.  This is
+   called between units, when no automatic or static symbols are
+   left. */
+void
+clear_symbols()
+{
+     Symbol **symbols;
+     size_t i, num;
+
+     linked_list_destroy(&auto_symbol_list);
+     linked_list_destroy(&block_static_list);
+     num = collect_symbols(&symbols, is_identifier, 0);
+     for (i = 0; i < num; i++) {
+	  Symbol *sym = symbols[i];
+
+	  if (sym->owner)
+	       unlink_symbol(sym);
+	  linked_list_destroy(&sym->ref_line);
+	  linked_list_destroy(&sym->caller);
+	  linked_list_destroy(&sym->callee);
+	  free(sym);
+     }
+     free(symbols);
+     linked_list_destroy(&static_func_list);
+}
+
 
 
 /* Special handling for function parameters */
@@ -397,3 +466,9 @@ move_parms(int level)
      }
 }
 
+/* Return the length of the longest chain in the symbol table */
+size_t
+symbol_max_chain()
+{
+     return symbol_table ? hash_get_max_bucket_length(symbol_table) : 0;
+}
@@ -0,0 +1,186 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Recursive search for source files (--recursive).
+
+   Each directory tree is walked by a child process, which writes the
+   names of the files found to a pipe, separated by NUL characters.
+   The pipe is read as a list of input files (see filelist.c), so that
+   the files are parsed while the walk goes on, and the time spent
+   waiting for the file system overlaps with parsing.  The entries of
+   each directory are sorted by name, so that the files are always
+   found in the same order and the output does not depend on the order
+   in which the file system returns them. */
+
+#include <cflow.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+
+/* Patterns of file names to look for, used if match_list is empty */
+static char *default_match[] = { "*.c", "*.h", NULL };
+
+/* Return 1 if the file NAME, whose base name is BASE, matches the
+   pattern PAT.  A pattern containing a slash is matched against the
+   whole name, others against the base name. */
+static int
+pattern_match(const char *pat, const char *name, const char *base)
+{
+     if (strchr(pat, '/'))
+	  return fnmatch(pat, name, FNM_PATHNAME) == 0;
+     return fnmatch(pat, base, 0) == 0;
+}
+
+static int
+list_match(struct linked_list *list, const char *name, const char *base)
+{
+     struct linked_list_entry *p;
+
+     for (p = linked_list_head(list); p; p = p->next)
+	  if (pattern_match(p->data, name, base))
+	       return 1;
+     return 0;
+}
+
+static int
+is_excluded(const char *name, const char *base)
+{
+     return list_match(exclude_list, name, base);
+}
+
+static int
+is_wanted(const char *name, const char *base)
+{
+     char **pat;
+
+     if (match_list)
+	  return list_match(match_list, name, base);
+     for (pat = default_match; *pat; pat++)
+	  if (pattern_match(*pat, name, base))
+	       return 1;
+     return 0;
+}
+
+static int
+compare_names(const void *a, const void *b)
+{
+     return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* Write the names of the source files in the directory DIR and its
+   subdirectories to FP.  Return 0 on success. */
+static int
+walk_dir(const char *dir, FILE *fp)
+{
+     DIR *dp;
+     struct dirent *ent;
+     char **names = NULL;
+     size_t count = 0, max = 0, i;
+     size_t dirlen = strlen(dir);
+     int status = 0;
+
+     dp = opendir(dir);
+     if (!dp) {
+	  error(0, errno, _("cannot open directory `%s'"), dir);
+	  return 1;
+     }
+     while ((ent = readdir(dp)) != NULL) {
+	  if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+	       continue;
+	  if (count == max) {
+	       max += 64;
+	       names = xrealloc(names, max * sizeof(names[0]));
+	  }
+	  names[count++] = xstrdup(ent->d_name);
+     }
+     closedir(dp);
+     qsort(names, count, sizeof(names[0]), compare_names);
+
+     for (i = 0; i < count; i++) {
+	  char *name;
+	  struct stat st;
+
+	  name = xmalloc(dirlen + strlen(names[i]) + 2);
+	  strcpy(name, dir);
+	  if (dirlen == 0 || dir[dirlen-1] != '/')
+	       strcat(name, "/");
+	  strcat(name, names[i]);
+
+	  if (is_excluded(name, names[i]))
+	       ;
+	  else if (lstat(name, &st)) {
+	       error(0, errno, _("cannot stat `%s'"), name);
+	       status = 1;
+	  } else if (S_ISDIR(st.st_mode)) {
+	       /* Flush the names found so far, to let the parser start on
+		  them while the subdirectory is being read */
+	       fflush(fp);
+	       if (walk_dir(name, fp))
+		    status = 1;
+	  } else if (is_wanted(name, names[i])
+		     /* Symbolic links are followed to files, but not to
+			directories, which could lead to loops */
+		     && (S_ISREG(st.st_mode)
+			 || (S_ISLNK(st.st_mode) && stat(name, &st) == 0
+			     && S_ISREG(st.st_mode)))) {
+	       fputs(name, fp);
+	       fputc(0, fp);
+	  }
+	  free(name);
+	  free(names[i]);
+     }
+     free(names);
+     return status;
+}
+
+/* Start the search for source files in the directory DIR.  Return the
+   list the names of the files found will be read from, or NULL on
+   error. */
+struct filelist *
+walk_start(const char *dir)
+{
+     int fd[2];
+     pid_t pid;
+
+     if (pipe(fd)) {
+	  error(0, errno, _("cannot create pipe"));
+	  return NULL;
+     }
+     pid = fork();
+     if (pid == -1) {
+	  error(0, errno, _("cannot fork"));
+	  close(fd[0]);
+	  close(fd[1]);
+	  return NULL;
+     }
+     if (pid == 0) {
+	  FILE *fp;
+	  int status;
+
+	  close(fd[0]);
+	  fp = fdopen(fd[1], "w");
+	  if (!fp)
+	       _exit(EX_FATAL);
+	  status = walk_dir(dir, fp);
+	  if (fclose(fp))
+	       status = 1;
+	  _exit(status ? EX_SOFT : EX_OK);
+     }
+     close(fd[1]);
+     fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+     return filelist_fdopen(fd[0], dir, pid);
+}
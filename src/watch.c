@@ -0,0 +1,382 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Watch mode (--watch).
+
+   The input files are watched for changes and the output is produced
+   anew each time some of them change.  To avoid retracting the
+   definitions, calls and references of a changed file from the symbol
+   table, the watching process keeps none: it only keeps the facts
+   recorded for each input file (see factdb.c).  Each output is
+   produced by a child process, which replays the facts of unchanged
+   files, parses the changed ones, recording their facts for later
+   runs, and writes the output.  Along with the facts, the child
+   reports the headers named in the line markers of each file it
+   parses (as --db does), so that editing a header makes the files
+   including it reparsed. */
+
+#include <cflow.h>
+#ifdef HAVE_SYS_INOTIFY_H
+# include <signal.h>
+# include <poll.h>
+# include <sys/inotify.h>
+# include <sys/stat.h>
+# include <sys/wait.h>
+
+struct watch_dep {
+     char *base;     /* Last component of the header name */
+     int wd;         /* Watch descriptor of its directory */
+     char name[1];   /* Header name */
+};
+
+struct watch_file {
+     char *name;     /* File name */
+     char *base;     /* Its last component */
+     int wd;         /* Watch descriptor of its directory */
+     char *facts;    /* Its facts, or NULL if it must be parsed */
+     FILE *fp;       /* Temporary file receiving its facts */
+     FILE *deps_fp;  /* Temporary file receiving its dependencies */
+     struct linked_list *deps; /* Headers its facts depend on */
+};
+
+static struct watch_file *watch_files;
+static size_t watch_count;
+static size_t watch_max;
+static int watch_fd = -1;  /* Inotify descriptor */
+
+static volatile sig_atomic_t stop;
+
+static void
+sig_stop(int sig)
+{
+     stop = 1;
+}
+
+/* Add NAME to the list of files to watch */
+void
+watch_add(char *name)
+{
+     struct watch_file *wf;
+     char *p;
+
+     if (watch_count == watch_max)
+	  watch_files = x2nrealloc(watch_files, &watch_max,
+				   sizeof(watch_files[0]));
+     wf = &watch_files[watch_count++];
+     wf->name = name;
+     p = strrchr(name, '/');
+     wf->base = p ? p + 1 : name;
+     wf->wd = -1;
+     wf->facts = NULL;
+     wf->fp = NULL;
+     wf->deps_fp = NULL;
+     wf->deps = NULL;
+}
+
+/* Watch the directory of the file NAME, whose last component is BASE.
+   Directories rather than files themselves are watched, to notice
+   files replaced by renaming (as many editors do).  Return the watch
+   descriptor, or -1 on error. */
+static int
+watch_dir(char *name, char *base)
+{
+     char *dir;
+     int wd;
+
+     if (base == name)
+	  dir = xstrdup(".");
+     else if (base - 1 == name)
+	  dir = xstrdup("/");
+     else {
+	  size_t len = base - 1 - name;
+	  dir = xmalloc(len + 1);
+	  memcpy(dir, name, len);
+	  dir[len] = 0;
+     }
+     wd = inotify_add_watch(watch_fd, dir,
+			    IN_CLOSE_WRITE|IN_MOVED_TO
+			    |IN_MOVED_FROM|IN_DELETE);
+     if (wd == -1)
+	  error(0, errno, _("cannot watch `%s'"), dir);
+     free(dir);
+     return wd;
+}
+
+/* Read the names of the headers WF depends on from its deps_fp, and
+   watch them */
+static void
+read_deps(struct watch_file *wf)
+{
+     char *line = NULL;
+     size_t size = 0;
+     ssize_t n;
+
+     linked_list_destroy(&wf->deps);
+     wf->deps = linked_list_create(free);
+     rewind(wf->deps_fp);
+     while ((n = getline(&line, &size, wf->deps_fp)) > 0) {
+	  struct watch_dep *dep;
+	  char *p;
+
+	  if (line[n-1] == '\n')
+	       line[--n] = 0;
+	  if (strcmp(line, wf->name) == 0)
+	       continue;
+	  dep = xmalloc(sizeof(*dep) + n);
+	  strcpy(dep->name, line);
+	  p = strrchr(dep->name, '/');
+	  dep->base = p ? p + 1 : dep->name;
+	  dep->wd = watch_dir(dep->name, dep->base);
+	  linked_list_append(&wf->deps, dep);
+     }
+     free(line);
+}
+
+/* Write the output to the file NAME atomically, so that readers never
+   see it incomplete */
+static void
+output_to(char *name)
+{
+     char *tmpname;
+     int fd;
+
+     tmpname = xmalloc(strlen(name) + 8);
+     strcpy(tmpname, name);
+     strcat(tmpname, ".XXXXXX");
+     fd = mkstemp(tmpname);
+     if (fd == -1)
+	  error(EX_FATAL, errno, _("cannot create temporary file for `%s'"),
+		name);
+     close(fd);
+     outname = tmpname;
+     output();
+     if (rename(tmpname, name)) {
+	  unlink(tmpname);
+	  error(EX_FATAL, errno, _("cannot rename `%s' to `%s'"),
+		tmpname, name);
+     }
+}
+
+/* Produce the output, parsing the files whose facts are not known.
+   Collect the facts recorded for them. */
+static void
+update()
+{
+     char *name = outname;
+     struct watch_file *wf;
+     pid_t pid;
+     int status;
+     size_t i;
+
+     for (i = 0; i < watch_count; i++) {
+	  wf = &watch_files[i];
+	  if (wf->facts)
+	       continue;
+	  if (debug)
+	       fprintf(stderr, _("%s: parsing\n"), wf->name);
+	  wf->fp = tmpfile();
+	  wf->deps_fp = tmpfile();
+	  if (!wf->fp || !wf->deps_fp)
+	       error(EX_FATAL, errno, _("cannot create temporary file"));
+     }
+
+     fflush(stdout);
+     fflush(stderr);
+     pid = fork();
+     if (pid == -1) {
+	  error(0, errno, _("cannot fork"));
+	  return;
+     }
+     if (pid == 0) {
+	  signal(SIGINT, SIG_DFL);
+	  signal(SIGTERM, SIG_DFL);
+	  signal(SIGHUP, SIG_DFL);
+	  for (i = 0; i < watch_count; i++) {
+	       wf = &watch_files[i];
+	       if (wf->facts)
+		    replay_facts(wf->facts, wf->name);
+	       else if (source(wf->name) == 0) {
+		    factdb_track_begin(wf->fp, wf->name);
+		    parse_input();
+		    factdb_track_end(wf->deps_fp);
+		    fflush(wf->fp);
+		    fflush(wf->deps_fp);
+	       }
+	  }
+	  if (strcmp(name, "-") == 0)
+	       output();
+	  else
+	       output_to(name);
+	  exit(EX_OK);
+     }
+
+     while (waitpid(pid, &status, 0) == -1)
+	  if (errno != EINTR)
+	       error(EX_FATAL, errno, _("waitpid failed"));
+
+     for (i = 0; i < watch_count; i++) {
+	  struct stat st;
+
+	  wf = &watch_files[i];
+	  if (!wf->fp)
+	       continue;
+	  /* An empty fact list means the file could not be read; it will
+	     be retried next time. */
+	  if (WIFEXITED(status) && WEXITSTATUS(status) == 0
+	      && fstat(fileno(wf->fp), &st) == 0 && st.st_size > 0) {
+	       wf->facts = xmalloc(st.st_size + 1);
+	       rewind(wf->fp);
+	       if (fread(wf->facts, 1, st.st_size, wf->fp) == st.st_size) {
+		    wf->facts[st.st_size] = 0;
+		    read_deps(wf);
+	       } else {
+		    free(wf->facts);
+		    wf->facts = NULL;
+	       }
+	  }
+	  fclose(wf->fp);
+	  wf->fp = NULL;
+	  fclose(wf->deps_fp);
+	  wf->deps_fp = NULL;
+     }
+}
+
+/* Return 1 if the file NAME in the directory watched by WD is one of
+   the headers WF depends on */
+static int
+dep_changed(struct watch_file *wf, int wd, char *name)
+{
+     struct linked_list_entry *p;
+
+     for (p = linked_list_head(wf->deps); p; p = p->next) {
+	  struct watch_dep *dep = p->data;
+	  if (dep->wd == wd && strcmp(dep->base, name) == 0)
+	       return 1;
+     }
+     return 0;
+}
+
+/* Mark the file NAME in the directory watched by WD as changed.
+   Return 1 if it is one of the input files or the headers they
+   depend on. */
+static int
+mark_changed(int wd, char *name)
+{
+     size_t i;
+     int found = 0;
+
+     for (i = 0; i < watch_count; i++) {
+	  struct watch_file *wf = &watch_files[i];
+	  if ((wf->wd == wd && strcmp(wf->base, name) == 0)
+	      || dep_changed(wf, wd, name)) {
+	       if (debug)
+		    fprintf(stderr, _("%s: changed\n"), wf->name);
+	       free(wf->facts);
+	       wf->facts = NULL;
+	       found = 1;
+	  }
+     }
+     return found;
+}
+
+/* Wait until some of the input files change.  Return 0 if they did, and
+   -1 if interrupted by a signal. */
+static int
+wait_changes(int fd)
+{
+     char buf[4096]
+	  __attribute__ ((aligned(__alignof__(struct inotify_event))));
+     struct pollfd pfd;
+     int changed = 0;
+
+     pfd.fd = fd;
+     pfd.events = POLLIN;
+     /* Wait for the first change, then collect the changes that follow
+	it closely (e.g. when several files are saved at once) */
+     while (!stop) {
+	  ssize_t n;
+	  char *p;
+
+	  if (changed) {
+	       int rc = poll(&pfd, 1, 100);
+	       if (rc == 0)
+		    return 0;
+	       if (rc == -1) {
+		    if (errno == EINTR)
+			 continue;
+		    error(EX_FATAL, errno, _("poll failed"));
+	       }
+	  }
+	  n = read(fd, buf, sizeof(buf));
+	  if (n == -1) {
+	       if (errno == EINTR)
+		    continue;
+	       error(EX_FATAL, errno, _("cannot read inotify events"));
+	  }
+	  for (p = buf; p < buf + n; ) {
+	       struct inotify_event *ev = (struct inotify_event *) p;
+	       if (ev->len && mark_changed(ev->wd, ev->name))
+		    changed = 1;
+	       p += sizeof(*ev) + ev->len;
+	  }
+     }
+     return -1;
+}
+
+/* Watch the input files and produce the output each time they change,
+   until terminated by a signal */
+void
+watch()
+{
+     struct sigaction act;
+     size_t i;
+
+     if (watch_count == 0)
+	  error(EX_USAGE, 0, _("no input files"));
+     watch_fd = inotify_init();
+     if (watch_fd == -1)
+	  error(EX_FATAL, errno, _("cannot initialize inotify"));
+     for (i = 0; i < watch_count; i++) {
+	  struct watch_file *wf = &watch_files[i];
+	  wf->wd = watch_dir(wf->name, wf->base);
+	  if (wf->wd == -1)
+	       exit(EX_FATAL);
+     }
+
+     memset(&act, 0, sizeof(act));
+     act.sa_handler = sig_stop;
+     sigemptyset(&act.sa_mask);
+     sigaction(SIGINT, &act, NULL);
+     sigaction(SIGTERM, &act, NULL);
+     sigaction(SIGHUP, &act, NULL);
+
+     do
+	  update();
+     while (wait_changes(watch_fd) == 0);
+     close(watch_fd);
+}
+
+#else
+void
+watch_add(char *name)
+{
+}
+
+void
+watch()
+{
+}
+#endif
@@ -0,0 +1,103 @@
+/* This file is part of GNU cflow
+   Copyright (C) 2017 Sergey Poznyakoff
+
+   GNU cflow is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU cflow is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+/* Test driver for libcflow.
+
+   Usage: cflowlib [OPTIONS] [FILE...] [+FILE...]
+
+   Sources named in OPTIONS and FILE arguments are added by name; those
+   given as +FILE are read into memory and added as buffers.  Prints the
+   symbols, the calls and the output produced by the library. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libcflow.h>
+
+static int
+print_symbol(const struct cflow_symbol *sym, void *data)
+{
+     printf("%s%s%s", sym->name,
+	    sym->flags & CFLOW_SYMBOL_FUNCTION ? "()" : "",
+	    sym->flags & CFLOW_SYMBOL_STATIC ? " static" : "");
+     if (sym->source)
+	  printf(" %s:%d: %s", sym->source, sym->line, sym->decl);
+     putchar('\n');
+     return 0;
+}
+
+static int
+print_edge(const struct cflow_symbol *caller,
+	   const struct cflow_symbol *callee, void *data)
+{
+     printf("%s -> %s\n", caller->name, callee->name);
+     return 0;
+}
+
+static int
+add_buffer(char *name)
+{
+     FILE *fp;
+     char *buf = NULL;
+     size_t size = 0, n;
+     char tmp[1024];
+     int rc;
+
+     fp = fopen(name, "r");
+     if (!fp) {
+	  perror(name);
+	  return 1;
+     }
+     while ((n = fread(tmp, 1, sizeof tmp, fp)) > 0) {
+	  buf = realloc(buf, size + n);
+	  if (!buf)
+	       abort();
+	  memcpy(buf + size, tmp, n);
+	  size += n;
+     }
+     fclose(fp);
+     rc = cflow_add_buffer(name, buf, size);
+     free(buf);
+     return rc;
+}
+
+int
+main(int argc, char **argv)
+{
+     int i, index;
+     int status = 0;
+
+     cflow_init();
+     cflow_init();
+     for (index = 1; index < argc && argv[index][0] != '+'; index++)
+	  ;
+     if (cflow_parse_options(index, argv, NULL))
+	  return 1;
+     for (i = index; i < argc; i++)
+	  if (add_buffer(argv[i] + 1))
+	       status = 1;
+     if (cflow_finish())
+	  status = 1;
+
+     printf("Symbols:\n");
+     cflow_iterate_symbols(print_symbol, NULL);
+     printf("Calls:\n");
+     cflow_iterate_edges(print_edge, NULL);
+     printf("Output:\n");
+     if (cflow_output("gnu", stdout))
+	  status = 1;
+     return status;
+}